@@ -0,0 +1,310 @@
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+#include "AsyncIO.h"
+
+AsyncIO* AsyncIO::engine = NULL;
+
+static pthread_mutex_t engineLock = PTHREAD_MUTEX_INITIALIZER;
+
+AsyncIO& AsyncIO::getEngine()
+{
+  if (engine == NULL) {
+    pthread_mutex_lock(&engineLock);
+    if (engine == NULL) engine = new AsyncIO();
+    pthread_mutex_unlock(&engineLock);
+  }
+  return *engine;
+}
+
+AsyncIO::AsyncIO()
+{
+  pthread_mutex_init(&ringLock, NULL);
+  pthread_mutex_init(&queueLock, NULL);
+  pthread_cond_init(&work, NULL);
+  pthread_cond_init(&finished, NULL);
+  queueHead = queueTail = NULL;
+
+  // fall back to the worker threads if the kernel has no io_uring,
+  // or if it is disabled, e.g., by a seccomp filter
+  if (!setupRing()) startWorkers();
+}
+
+RC AsyncIO::read(Request* reqs, int count)
+{
+  RC rc = 0;
+
+  if (count <= 0) return 0;
+
+  if (ringFd >= 0) {
+    // the ring holds RING_ENTRIES requests at a time
+    for (int i = 0; i < count; i += RING_ENTRIES) {
+      RC r = readRing(reqs + i, (count - i < RING_ENTRIES) ? count - i : RING_ENTRIES);
+      if (r < 0 && rc == 0) rc = r;
+    }
+  } else {
+    rc = readThreads(reqs, count);
+  }
+
+  return rc;
+}
+
+//
+// io_uring
+//
+
+bool AsyncIO::setupRing()
+{
+  struct io_uring_params params;
+  size_t sqSize, cqSize;
+  char*  sq;
+  char*  cq;
+
+  ringFd = -1;
+
+  memset(&params, 0, sizeof(params));
+  int fd = ::syscall(__NR_io_uring_setup, RING_ENTRIES, &params);
+  if (fd < 0) return false;
+
+  // map the submission and completion queue rings and the array of
+  // submission queue entries shared with the kernel
+  sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cqSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    if (cqSize > sqSize) sqSize = cqSize;
+    cqSize = sqSize;
+  }
+
+  sq = (char*) ::mmap(NULL, sqSize, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE,
+                      fd, IORING_OFF_SQ_RING);
+  if (sq == MAP_FAILED) { ::close(fd); return false; }
+
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    cq = sq;
+  } else {
+    cq = (char*) ::mmap(NULL, cqSize, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE,
+                        fd, IORING_OFF_CQ_RING);
+    if (cq == MAP_FAILED) { ::munmap(sq, sqSize); ::close(fd); return false; }
+  }
+
+  sqes = (struct io_uring_sqe*) ::mmap(NULL, params.sq_entries * sizeof(struct io_uring_sqe),
+                                       PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE,
+                                       fd, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED) {
+    ::munmap(sq, sqSize);
+    if (cq != sq) ::munmap(cq, cqSize);
+    ::close(fd);
+    return false;
+  }
+
+  sqHead = (unsigned*)(sq + params.sq_off.head);
+  sqTail = (unsigned*)(sq + params.sq_off.tail);
+  sqMask = *(unsigned*)(sq + params.sq_off.ring_mask);
+  sqArray = (unsigned*)(sq + params.sq_off.array);
+  cqHead = (unsigned*)(cq + params.cq_off.head);
+  cqTail = (unsigned*)(cq + params.cq_off.tail);
+  cqMask = *(unsigned*)(cq + params.cq_off.ring_mask);
+  cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+
+  ringFd = fd;
+  return true;
+}
+
+int AsyncIO::reapRing(Request* reqs, long long begin)
+{
+  unsigned head = *cqHead;
+  int n = 0;
+
+  __sync_synchronize();
+  for (; head != *cqTail; head++) {
+    struct io_uring_cqe* cqe = &cqes[head & cqMask];
+    Request& req = reqs[(int)cqe->user_data];
+
+    req.rc = (cqe->res == req.pf->pageSize) ? 0 : RC_FILE_READ_FAILED;
+    if (req.rc == 0) {
+      IOStats::read(req.pf->stats, 1, req.pf->pageSize, IOStats::now() - begin);
+    }
+    n++;
+  }
+  __sync_synchronize();
+  *cqHead = head;
+  return n;
+}
+
+RC AsyncIO::readRing(Request* reqs, int count)
+{
+  RC rc = 0;
+  struct iovec iov[RING_ENTRIES];
+  unsigned tail;
+  int queued, completed, submitted;
+  bool failed = false;
+  long long begin;
+
+  pthread_mutex_lock(&ringLock);
+
+  // the ring was given up by an earlier batch
+  if (ringFd < 0) {
+    pthread_mutex_unlock(&ringLock);
+    return readThreads(reqs, count);
+  }
+
+  // fill one submission queue entry per request.
+  // IORING_OP_READV is used because it is the oldest read operation
+  tail = *sqTail;
+  queued = 0;
+  for (int i = 0; i < count; i++) {
+    // a positive rc marks a request that is not completed yet
+    reqs[i].rc = 1;
+
+    // a compressed page has to be decompressed after it is read,
+    // so it is left to the synchronous retry below
+    if (reqs[i].pf->compressed) continue;
+
+    unsigned idx = tail++ & sqMask;
+    struct io_uring_sqe* sqe = &sqes[idx];
+
+    iov[i].iov_base = reqs[i].buffer;
+    iov[i].iov_len = reqs[i].pf->pageSize;
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_READV;
+    sqe->fd = reqs[i].pf->fd;
+    sqe->addr = (unsigned long) &iov[i];
+    sqe->len = 1;
+    sqe->off = reqs[i].pf->offsetOf(reqs[i].pid);
+    sqe->user_data = i;
+    sqArray[idx] = idx;
+    queued++;
+  }
+
+  // the kernel must see the entries before the new tail
+  __sync_synchronize();
+  *sqTail = tail;
+
+  // submit the whole batch and reap the completions as they arrive.
+  // the latency of a request is the time until its completion is reaped
+  begin = IOStats::now();
+  submitted = 0;
+  for (completed = 0; completed < queued; ) {
+    int r = ::syscall(__NR_io_uring_enter, ringFd, queued - submitted,
+                      1, IORING_ENTER_GETEVENTS, NULL, 0);
+    if (r < 0) {
+      if (errno == EINTR) continue;
+      failed = true;
+      break;
+    }
+    submitted += r;
+    completed += reapRing(reqs, begin);
+  }
+
+  if (failed) {
+    // the entries the kernel has not taken are retracted, and the
+    // requests in flight are reaped, since the kernel writes into iov
+    // and the buffers until they complete. the ring is not used again,
+    // and this batch and the later ones go to the worker threads
+    *sqTail = *sqHead;
+    __sync_synchronize();
+    completed += reapRing(reqs, begin);
+    while (completed < submitted) {
+      if (::syscall(__NR_io_uring_enter, ringFd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0 &&
+          errno != EINTR) {
+        sched_yield();
+      }
+      completed += reapRing(reqs, begin);
+    }
+    ringFd = -1;
+    startWorkers();
+  }
+
+  pthread_mutex_unlock(&ringLock);
+
+  // a request the kernel did not complete is retried synchronously
+  for (int i = 0; i < count; i++) {
+    if (reqs[i].rc > 0) readOne(reqs[i]);
+    if (reqs[i].rc < 0 && rc == 0) rc = reqs[i].rc;
+  }
+
+  return rc;
+}
+
+//
+// the worker thread pool
+//
+
+void AsyncIO::startWorkers()
+{
+  for (int i = 0; i < WORKER_COUNT; i++) {
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, workerMain, this) == 0) {
+      pthread_detach(thread);
+    }
+  }
+}
+
+RC AsyncIO::readThreads(Request* reqs, int count)
+{
+  RC rc = 0;
+  Batch batch;
+
+  batch.reqs = reqs;
+  batch.count = count;
+  batch.next = 0;
+  batch.done = 0;
+  batch.qnext = NULL;
+  batch.query = IOStats::getQuery();
+
+  // queue the batch and wait for the workers to complete it
+  pthread_mutex_lock(&queueLock);
+  if (queueTail == NULL) queueHead = &batch;
+  else queueTail->qnext = &batch;
+  queueTail = &batch;
+  pthread_cond_broadcast(&work);
+
+  while (batch.done < batch.count) pthread_cond_wait(&finished, &queueLock);
+  pthread_mutex_unlock(&queueLock);
+
+  for (int i = 0; i < count; i++) {
+    if (reqs[i].rc < 0) { rc = reqs[i].rc; break; }
+  }
+  return rc;
+}
+
+void* AsyncIO::workerMain(void* arg)
+{
+  AsyncIO* io = (AsyncIO*) arg;
+
+  for (;;) {
+    pthread_mutex_lock(&io->queueLock);
+    while (io->queueHead == NULL) pthread_cond_wait(&io->work, &io->queueLock);
+
+    // take the next request of the oldest batch
+    Batch* b = io->queueHead;
+    Request& req = b->reqs[b->next++];
+    if (b->next == b->count) {
+      io->queueHead = b->qnext;
+      if (io->queueHead == NULL) io->queueTail = NULL;
+    }
+    pthread_mutex_unlock(&io->queueLock);
+
+    IOStats::setQuery(b->query);
+    readOne(req);
+    IOStats::setQuery(NULL);
+
+    pthread_mutex_lock(&io->queueLock);
+    if (++b->done == b->count) pthread_cond_broadcast(&io->finished);
+    pthread_mutex_unlock(&io->queueLock);
+  }
+
+  return NULL;
+}
+
+RC AsyncIO::readOne(Request& req)
+{
+  req.rc = req.pf->readPage(req.pid, req.buffer);
+  return req.rc;
+}
@@ -0,0 +1,97 @@
+#ifndef ASYNCIO_H
+#define ASYNCIO_H
+
+#include <pthread.h>
+#include "Bruinbase.h"
+#include "PageFile.h"
+
+/**
+ * The engine that reads a batch of pages in parallel.
+ * All requests of a batch are handed to the kernel at once, so the
+ * disk can serve them in any order and overlap their latencies,
+ * instead of the caller waiting for each page in turn.
+ *
+ * The engine uses io_uring, set up with raw system calls, if the kernel
+ * supports it. Otherwise, the requests are served by a pool of worker
+ * threads that call pread().
+ */
+class AsyncIO {
+ public:
+
+  static const int RING_ENTRIES = 64;   // # requests in flight with io_uring
+  static const int WORKER_COUNT = 8;    // # threads of the fallback pool
+
+  // a request to read one page
+  struct Request {
+    const PageFile* pf;   // the file to read from
+    PageId pid;           // the page to read
+    char*  buffer;        // the memory to read the page into
+    RC     rc;            // set to the result of the read
+  };
+
+  /**
+   * @return the I/O engine of the process. it is created on first use
+   */
+  static AsyncIO& getEngine();
+
+  /**
+   * read all pages of a batch and wait until every read is completed.
+   * @param reqs[IN/OUT] the requests. their rc fields are set on return
+   * @param count[IN] # requests
+   * @return error code of the first failed request. 0 if no error
+   */
+  RC read(Request* reqs, int count);
+
+  /**
+   * @return "io_uring" or "threads", the mechanism used by the engine
+   */
+  const char* getName() const { return (ringFd >= 0) ? "io_uring" : "threads"; }
+
+ private:
+  AsyncIO();
+
+  // io_uring
+  bool setupRing();
+  RC   readRing(Request* reqs, int count);
+
+  // reap the completions in the ring. returns # requests completed
+  int  reapRing(Request* reqs, long long begin);
+
+  // the worker thread pool
+  struct Batch {
+    Request* reqs;
+    int      count;
+    int      next;      // the next request to hand to a worker
+    int      done;      // # requests completed
+    Batch*   qnext;     // next batch in the queue
+    IOStats::Query* query; // the query the reads count for
+  };
+  void  startWorkers();
+  RC    readThreads(Request* reqs, int count);
+  static void* workerMain(void* arg);
+
+  // read one page with pread(), as a worker thread does
+  static RC readOne(Request& req);
+
+  int       ringFd;     // the io_uring instance. -1 if not available
+  pthread_mutex_t ringLock; // one batch uses the ring at a time
+  volatile unsigned* sqHead;  // the submission queue ring
+  volatile unsigned* sqTail;
+  unsigned  sqMask;
+  unsigned* sqArray;
+  struct io_uring_sqe* sqes;
+  volatile unsigned* cqHead;  // the completion queue ring
+  volatile unsigned* cqTail;
+  unsigned  cqMask;
+  struct io_uring_cqe* cqes;
+
+  pthread_mutex_t queueLock; // protects the batch queue
+  pthread_cond_t  work;      // signaled when a batch is queued
+  pthread_cond_t  finished;  // signaled when a batch is completed
+  Batch*    queueHead;  // the batches with requests not handed out yet
+  Batch*    queueTail;
+
+  static AsyncIO* engine;  // the engine of the process
+};
+
+#endif // ASYNCIO_H
@@ -23,16 +23,21 @@ BTreeIndex::BTreeIndex()
 /*
  * Open the index file in read or write mode.
  * Under 'w' mode, the index file should be created if it does not exist.
+ * Under 'm' mode, the index file is memory-mapped for reading.
  * @param indexname[IN] the name of the index file
- * @param mode[IN] 'r' for read, 'w' for write
+ * @param mode[IN] 'r' for read, 'w' for write, 'm' for mapped read
+ * @param pageSize[IN] the page size of a new index file. 0 for the default
  * @return error code. 0 if no error
  */
-RC BTreeIndex::open(const string& indexname, char mode)
+RC BTreeIndex::open(const string& indexname, char mode, int pageSize)
 {
-  if(pf.open(indexname, mode))
+  if(pf.open(indexname, mode, pageSize))
     return 1;
 
-  char info[PageFile::PAGE_SIZE];
+  // Index lookups jump from node to node
+  pf.advise(PageFile::RANDOM);
+
+  char info[PageFile::MAX_PAGE_SIZE];
   // Set the rootpid and tree height vars
   if (pf.endPid() == 0)
   {
@@ -50,12 +55,13 @@ RC BTreeIndex::open(const string& indexname, char mode)
   }
   else
   {
-    if (pf.read(0, info))
+    PageHandle page;
+    if (pf.read(0, page))
     {
       return 2;
     }
-    rootPid = *((PageId *)info);
-    treeHeight = *((int *)(info+sizeof(PageId)));
+    rootPid = *((const PageId *)page.data());
+    treeHeight = *((const int *)(page.data()+sizeof(PageId)));
   }
 
   return 0;
@@ -68,13 +74,14 @@ RC BTreeIndex::open(const string& indexname, char mode)
 RC BTreeIndex::close()
 {
     // Store info variables
-    char info[PageFile::PAGE_SIZE];
+    char info[PageFile::MAX_PAGE_SIZE];
     *((PageId *)info) = rootPid;
     *((int *)(info+sizeof(PageId))) = treeHeight;
-    pf.write(0,info);
+    RC rc = pf.write(0,info);
 
     // Close page file
-    return pf.close();
+    RC crc = pf.close();
+    return (rc < 0) ? rc : crc;
 }
 
 /*
@@ -98,12 +105,13 @@ RC BTreeIndex::insert_helper(int key, const RecordId& rid, PageId pid, int heigh
     if (ln.insert(key, rid))
     {
       // Overflow. Create new leaf node and split.
-      BTLeafNode newNode;
+      BTLeafNode newNode(pf.getPageSize());
       if (ln.insertAndSplit(key, rid, newNode, ofKey))
         return 1;
 
       // Set new nextNode pointers
-      ofPid = pf.endPid();
+      if (pf.allocatePage(ofPid))
+        return 1;
       newNode.setNextNodePtr(ln.getNextNodePtr());
       ln.setNextNodePtr(ofPid);
 
@@ -123,7 +131,8 @@ RC BTreeIndex::insert_helper(int key, const RecordId& rid, PageId pid, int heigh
     nln.read(pid, pf);
     nln.locate(key, eid);
     nln.readEntry(eid, child);
-    insert_helper(key, rid, child, height+1, ofKey, ofPid);
+    if (insert_helper(key, rid, child, height+1, ofKey, ofPid))
+      return 1;
     if (ofKey > 0)
     {
       // Child node overflowed. Insert (key,pid) into this node.
@@ -131,12 +140,13 @@ RC BTreeIndex::insert_helper(int key, const RecordId& rid, PageId pid, int heigh
       {
         // Non-leaf node overflow. Split node between siblings.
         int midKey;
-        BTNonLeafNode sibling;
+        BTNonLeafNode sibling(pf.getPageSize());
 
         if (nln.insertAndSplit(ofKey, ofPid, sibling, midKey))
           return 1;
         ofKey = midKey;
-        ofPid = pf.endPid();
+        if (pf.allocatePage(ofPid))
+          return 1;
         if (sibling.write(ofPid, pf))
           return 1;
       }
@@ -164,9 +174,10 @@ RC BTreeIndex::insert(int key, const RecordId& rid)
   //If new index, simply add a root node
   if (treeHeight == 0)
   {
-    BTLeafNode ln;
+    BTLeafNode ln(pf.getPageSize());
     ln.insert(key, rid);
-    rootPid = pf.endPid();
+    if (pf.allocatePage(rootPid))
+      return 1;
     treeHeight = 1;
     ln.write(rootPid, pf);
     return 0;
@@ -178,9 +189,10 @@ RC BTreeIndex::insert(int key, const RecordId& rid)
   // If overflow at top level, create new root node
   if (ofKey > 0)
   {
-    BTNonLeafNode newRoot;
+    BTNonLeafNode newRoot(pf.getPageSize());
     newRoot.initializeRoot(rootPid, ofKey, ofPid);
-    rootPid = pf.endPid();
+    if (pf.allocatePage(rootPid))
+      return 1;
     treeHeight++;
     newRoot.write(rootPid, pf);
   }
@@ -224,9 +236,57 @@ RC BTreeIndex::locate(int searchKey, IndexCursor& cursor)
   BTLeafNode ln;
   ln.read(pid, pf);
  
+  // a key above all the keys of the leaf is located at the first entry
+  // of the next leaf. past the last leaf, readForward() fails
   cursor.pid = pid;
-  ln.locate(searchKey, cursor.eid);
+  if (ln.locate(searchKey, cursor.eid))
+  {
+    cursor.pid = ln.getNextNodePtr();
+    cursor.eid = 0;
+  }
+
+  return 0;
+}
+
+/*
+ * Find the smallest and the largest key in the index.
+ * The first and the last leaf nodes are reached from the root along the
+ * leftmost and the rightmost pointers, so 2*treeHeight nodes are read.
+ * @param minKey[OUT] the smallest key in the index
+ * @param maxKey[OUT] the largest key in the index
+ * @return error code. 0 if no error. RC_NO_SUCH_RECORD if the index is empty
+ */
+RC BTreeIndex::getKeyBounds(int& minKey, int& maxKey)
+{
+  RecordId rid;
+  RC rc;
+
+  if (treeHeight == 0)
+    return RC_NO_SUCH_RECORD;
+
+  for (int last = 0; last <= 1; last++)
+  {
+    PageId pid = rootPid;
+    for (int i = 0; i < treeHeight-1; i++)
+    {
+      BTNonLeafNode nln;
+      if ((rc = nln.read(pid, pf)) < 0)
+        return rc;
+      // The pointer before the first key leads to the smallest keys
+      if (nln.readEntry(last ? nln.getKeyCount()-1 : -1, pid))
+        return RC_INVALID_FILE_FORMAT;
+    }
 
+    BTLeafNode ln;
+    if ((rc = ln.read(pid, pf)) < 0)
+      return rc;
+    if (ln.getKeyCount() == 0)
+      return RC_NO_SUCH_RECORD;
+    if (last)
+      ln.readEntry(ln.getKeyCount()-1, maxKey, rid);
+    else
+      ln.readEntry(0, minKey, rid);
+  }
   return 0;
 }
 
@@ -241,16 +301,18 @@ RC BTreeIndex::locate(int searchKey, IndexCursor& cursor)
 RC BTreeIndex::readForward(IndexCursor& cursor, int& key, RecordId& rid)
 {
 
-  BTLeafNode ln;
-  ln.read(cursor.pid, pf);
-  ln.readEntry(cursor.eid, key, rid);
-
   //Check if we have a valid page
   if (cursor.pid <= 0 || cursor.pid >= pf.endPid())
   {
     return 1;
   }
 
+  BTLeafNode ln;
+  if (ln.read(cursor.pid, pf) || ln.readEntry(cursor.eid, key, rid))
+  {
+    return RC_INVALID_CURSOR;
+  }
+
   // Increment cursor
   cursor.eid++;
   if (cursor.eid >= ln.getKeyCount())
@@ -38,11 +38,13 @@ class BTreeIndex {
   /**
    * Open the index file in read or write mode.
    * Under 'w' mode, the index file should be created if it does not exist.
+   * Under 'm' mode, the index file is memory-mapped for reading.
    * @param indexname[IN] the name of the index file
-   * @param mode[IN] 'r' for read, 'w' for write
+   * @param mode[IN] 'r' for read, 'w' for write, 'm' for mapped read
+   * @param pageSize[IN] the page size of a new index file. 0 for the default
    * @return error code. 0 if no error
    */
-  RC open(const std::string& indexname, char mode);
+  RC open(const std::string& indexname, char mode, int pageSize = 0);
 
   /**
    * Close the index file.
@@ -89,13 +91,22 @@ class BTreeIndex {
    * @return error code. 0 if no error
    */
   RC readForward(IndexCursor& cursor, int& key, RecordId& rid);
+
+  /**
+   * Find the smallest and the largest key in the index by reading the
+   * first and the last leaf nodes.
+   * @param minKey[OUT] the smallest key in the index
+   * @param maxKey[OUT] the largest key in the index
+   * @return error code. 0 if no error
+   */
+  RC getKeyBounds(int& minKey, int& maxKey);
   
  private:
 
   /**
    * Recursive function for insert
    */
-  RC insert_helper(int key, const RecordId& rid, PageId pid, int height, int& ofKey, PageId& pid);
+  RC insert_helper(int key, const RecordId& rid, PageId pid, int height, int& ofKey, PageId& ofPid);
 
   PageFile pf;         /// the PageFile used to store the actual b+tree in disk
 
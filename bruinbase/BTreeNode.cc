@@ -1,7 +1,14 @@
+#include <cstring>
+#include <strings.h>
 #include "BTreeNode.h"
 
 using namespace std;
 
+/*
+ * The content of a node that has not been read or modified yet
+ */
+static const char emptyPage[PageFile::MAX_PAGE_SIZE] = { 0 };
+
 
 /*
  * Represents an entry within a leaf node
@@ -14,20 +21,39 @@ struct BTLeafNode::Entry {
 /*
  * Constructor for a BTLeafNode
  */
-BTLeafNode::BTLeafNode()
+BTLeafNode::BTLeafNode(int pageSize)
+{
+  page = emptyPage;
+  buffer = NULL;
+  this->pageSize = pageSize;
+}
+
+BTLeafNode::~BTLeafNode()
 {
-  bzero(buffer, PageFile::PAGE_SIZE);
+  delete [] buffer;
 }
 
 /*
  * Read the content of the node from the page pid in the PageFile pf.
+ * The page is pinned in the buffer pool and accessed in place.
  * @param pid[IN] the PageId to read
  * @param pf[IN] PageFile to read from
  * @return 0 if successful. Return an error code if there is an error.
  */
 RC BTLeafNode::read(PageId pid, const PageFile& pf)
 {
-  return pf.read(pid, buffer);
+  RC rc;
+
+  page = emptyPage;
+  if (pf.getPageSize() != pageSize) {
+    // the buffer was allocated for a node of another file
+    delete [] buffer;
+    buffer = NULL;
+    pageSize = pf.getPageSize();
+  }
+  if ((rc = pf.read(pid, handle)) < 0) return rc;
+  page = handle.data();
+  return 0;
 }
     
 /*
@@ -38,12 +64,26 @@ RC BTLeafNode::read(PageId pid, const PageFile& pf)
  */
 RC BTLeafNode::write(PageId pid, PageFile& pf)
 {
-  return pf.write(pid,buffer);
+  return pf.write(pid, page);
+}
+
+/*
+ * Copy the content of the node to buffer before it is modified,
+ * so that the page in the buffer pool is left untouched.
+ */
+void BTLeafNode::makeWritable()
+{
+  if (page == buffer) return;
+
+  if (buffer == NULL) buffer = new char[pageSize];
+  memcpy(buffer, page, pageSize);
+  page = buffer;
+  handle.release();
 }
 
 int BTLeafNode::getMaxKeyCount()
 {
-  return (PageFile::PAGE_SIZE-sizeof(PageId))/(sizeof(Entry));
+  return (pageSize-sizeof(PageId))/(sizeof(Entry));
 }
 
 /*
@@ -52,15 +92,19 @@ int BTLeafNode::getMaxKeyCount()
  */
 int BTLeafNode::getKeyCount()
 {
-  int count = 0;
-  Entry* entry = (Entry *) buffer;
-  while(count < getMaxKeyCount()) {
-    if (entry->key == 0)
-      break;
-    count++;
-    entry++;
+  // the used entries come first, followed by the empty ones
+  // with zero keys, so the first empty entry is found by bisection.
+  // a linear scan would be slow for the large nodes of large pages
+  const Entry* entry = (const Entry *) page;
+  int lo = 0, hi = getMaxKeyCount();
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    if (entry[mid].key == 0)
+      hi = mid;
+    else
+      lo = mid + 1;
   }
-  return count;
+  return lo;
 }
 
 /*
@@ -75,6 +119,7 @@ RC BTLeafNode::insert(int key, const RecordId& rid)
 
   if (getKeyCount() >= getMaxKeyCount())
     return 1;  //Node is full
+  makeWritable();
   if (locate (key, insertId))
     insertId = getKeyCount();  //Add to end of node
 
@@ -114,8 +159,11 @@ RC BTLeafNode::insertAndSplit(int key, const RecordId& rid,
   swap.key = key;
   swap.rid = rid;
 
+  makeWritable();
+
+  //A key larger than all keys goes after the last entry
   if (locate(swap.key, eid))
-    return 2;
+    eid = keyCount;
 
   //If before split, keep swapping until we get to split
   while (eid < siblingId) {
@@ -157,9 +205,11 @@ RC BTLeafNode::insertAndSplit(int key, const RecordId& rid,
  */
 RC BTLeafNode::locate(int searchKey, int& eid)
 {
+  int keyCount = getKeyCount();
+
   eid = 0;
-  while (eid < getKeyCount()) {
-    Entry* entry = (Entry *)buffer + eid;
+  while (eid < keyCount) {
+    const Entry* entry = (const Entry *)page + eid;
     if (searchKey > entry->key)
       eid++;
     else
@@ -167,7 +217,7 @@ RC BTLeafNode::locate(int searchKey, int& eid)
   }
 
   // Make sure we haven't passed the last entry
-  if (eid == getKeyCount()) {
+  if (eid == keyCount) {
     eid = -1;
     return 1;
   }
@@ -186,7 +236,7 @@ RC BTLeafNode::readEntry(int eid, int& key, RecordId& rid)
   if (eid < 0 || eid >= getKeyCount())
     return 1;
 
-  Entry* entry = (Entry *)buffer + eid;
+  const Entry* entry = (const Entry *)page + eid;
   rid = entry->rid;
   key = entry->key;
   return 0;
@@ -198,7 +248,7 @@ RC BTLeafNode::readEntry(int eid, int& key, RecordId& rid)
  */
 PageId BTLeafNode::getNextNodePtr()
 {
-  PageId* pid = (PageId *)(buffer+PageFile::PAGE_SIZE) - 1;
+  const PageId* pid = (const PageId *)(page+pageSize) - 1;
   return *pid;
 }
 
@@ -209,7 +259,8 @@ PageId BTLeafNode::getNextNodePtr()
  */
 RC BTLeafNode::setNextNodePtr(PageId pid)
 {
-  PageId* ptr = (PageId *)(buffer+PageFile::PAGE_SIZE) - 1;
+  makeWritable();
+  PageId* ptr = (PageId *)(buffer+pageSize) - 1;
   *ptr = pid;
   return 0;
 }
@@ -223,15 +274,42 @@ struct BTNonLeafNode::Entry
   PageId pid;
 };
 
+/*
+ * Constructor for a BTNonLeafNode
+ */
+BTNonLeafNode::BTNonLeafNode(int pageSize)
+{
+  page = emptyPage;
+  buffer = NULL;
+  this->pageSize = pageSize;
+}
+
+BTNonLeafNode::~BTNonLeafNode()
+{
+  delete [] buffer;
+}
+
 /*
  * Read the content of the node from the page pid in the PageFile pf.
+ * The page is pinned in the buffer pool and accessed in place.
  * @param pid[IN] the PageId to read
  * @param pf[IN] PageFile to read from
  * @return 0 if successful. Return an error code if there is an error.
  */
 RC BTNonLeafNode::read(PageId pid, const PageFile& pf)
 {
-  return pf.read(pid, buffer);
+  RC rc;
+
+  page = emptyPage;
+  if (pf.getPageSize() != pageSize) {
+    // the buffer was allocated for a node of another file
+    delete [] buffer;
+    buffer = NULL;
+    pageSize = pf.getPageSize();
+  }
+  if ((rc = pf.read(pid, handle)) < 0) return rc;
+  page = handle.data();
+  return 0;
 }
     
 /*
@@ -242,7 +320,21 @@ RC BTNonLeafNode::read(PageId pid, const PageFile& pf)
  */
 RC BTNonLeafNode::write(PageId pid, PageFile& pf)
 {
-  return pf.write(pid, buffer);
+  return pf.write(pid, page);
+}
+
+/*
+ * Copy the content of the node to buffer before it is modified,
+ * so that the page in the buffer pool is left untouched.
+ */
+void BTNonLeafNode::makeWritable()
+{
+  if (page == buffer) return;
+
+  if (buffer == NULL) buffer = new char[pageSize];
+  memcpy(buffer, page, pageSize);
+  page = buffer;
+  handle.release();
 }
 
 /*
@@ -250,7 +342,7 @@ RC BTNonLeafNode::write(PageId pid, PageFile& pf)
  */
 int BTNonLeafNode::getMaxKeyCount()
 {
-  return (PageFile::PAGE_SIZE-sizeof(PageId))/(sizeof(Entry));
+  return (pageSize-sizeof(PageId))/(sizeof(Entry));
 }
 
 /*
@@ -259,15 +351,17 @@ int BTNonLeafNode::getMaxKeyCount()
  */
 int BTNonLeafNode::getKeyCount()
 {
-  int count = 0;
-  Entry* entry = (Entry *) buffer;
-  while(count < getMaxKeyCount()) {
-    if (entry->key == 0)
-      break;
-    count++;
-    entry++;
+  // the first empty entry is found by bisection as in a leaf node
+  const Entry* entry = (const Entry *) page;
+  int lo = 0, hi = getMaxKeyCount();
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    if (entry[mid].key == 0)
+      hi = mid;
+    else
+      lo = mid + 1;
   }
-  return count;
+  return lo;
 }
 
 /*
@@ -286,6 +380,7 @@ RC BTNonLeafNode::insert(int key, PageId pid)
     insertId = 0;  //Insert at very beginning
   else // We want to insert in the slot after the located entry
     insertId++;
+  makeWritable();
 
   Entry* insertEntry = (Entry *)buffer + insertId;
   Entry* curEntry = (Entry *)buffer + getKeyCount();
@@ -322,8 +417,10 @@ RC BTNonLeafNode::insertAndSplit(int key, PageId pid, BTNonLeafNode& sibling, in
   swap.key = key;
   swap.pid = pid;
 
-  if (locate(swap.key, eid))
-    return 2;
+  makeWritable();
+
+  //A key smaller than all keys goes into the first entry (eid is -1)
+  locate(swap.key, eid);
   eid++;
 
   //If before split, keep swapping until we get to split
@@ -377,7 +474,7 @@ RC BTNonLeafNode::locate(int searchKey, int& eid)
 {
   eid = getKeyCount()-1;
   while (eid >= 0) {
-    Entry* entry = (Entry *)buffer + eid;
+    const Entry* entry = (const Entry *)page + eid;
     if (searchKey < entry->key)
       eid--;
     else
@@ -403,11 +500,11 @@ RC BTNonLeafNode::readEntry(int eid, PageId& pid)
 
   // Return the pointer not associated with an Entry
   if (eid < 0) {
-    PageId *ptr = (PageId *)(buffer+PageFile::PAGE_SIZE-sizeof(PageId));
+    const PageId *ptr = (const PageId *)(page+pageSize-sizeof(PageId));
     pid = *ptr;
   }
   else {
-    Entry* entry = (Entry *)buffer + eid;
+    const Entry* entry = (const Entry *)page + eid;
     pid = entry->pid;
   }
   return 0;
@@ -423,7 +520,10 @@ RC BTNonLeafNode::readEntry(int eid, PageId& pid)
 RC BTNonLeafNode::initializeRoot(PageId pid1, int key, PageId pid2)
 {
   // Zero out the buffer
-  bzero(buffer, PageFile::PAGE_SIZE);
+  if (buffer == NULL) buffer = new char[pageSize];
+  page = buffer;
+  handle.release();
+  bzero(buffer, pageSize);
 
   // A root entry is represented as follows:
   //  One Entry node, consisting of a key and a pointer (pid2)
@@ -436,7 +536,7 @@ RC BTNonLeafNode::initializeRoot(PageId pid1, int key, PageId pid2)
 
   *((Entry *) buffer) = root;
 
-  PageId *ptr1 = (PageId *)(buffer+PageFile::PAGE_SIZE-sizeof(PageId));
+  PageId *ptr1 = (PageId *)(buffer+pageSize-sizeof(PageId));
   *ptr1 = pid1;
   return 0;
 }
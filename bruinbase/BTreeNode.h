@@ -20,8 +20,10 @@ class BTLeafNode {
   public:
    /**
    * Constructor for a BTLeafNode
+   * @param pageSize[IN] the page size of the file of the node
    */
-   BTLeafNode();
+   BTLeafNode(int pageSize = PageFile::DEFAULT_PAGE_SIZE);
+   ~BTLeafNode();
 
    /**
     * Insert the (key, rid) pair to the node.
@@ -101,7 +103,12 @@ class BTLeafNode {
     */
     RC write(PageId pid, PageFile& pf);
 
+   /**
+    * Return the maximum number of keys possible in the node.
+    * @return the number of keys in the node
+    */
     int getMaxKeyCount();
+
   private:
 
    /**
@@ -110,15 +117,35 @@ class BTLeafNode {
     struct Entry;
 
    /**
-    * The main memory buffer for loading the content of the disk page 
-    * that contains the node.
+    * The content of the node. It points to the page pinned in the
+    * buffer pool until the node is modified, and to buffer afterwards.
+    */
+    const char* page;
+
+   /**
+    * The buffer pool page that the node was read from.
     */
-    char buffer[PageFile::PAGE_SIZE];
+    PageHandle handle;
 
    /**
-    * Static function which calculates the max number of keys in the
-    * page
+    * The main memory buffer for the content of a modified node.
+    * It is allocated when the node is modified for the first time.
     */
+    char* buffer;
+
+   /**
+    * The size of the node, i.e., the page size of its file
+    */
+    int pageSize;
+
+   /**
+    * Copy the content of the node to buffer before it is modified.
+    */
+    void makeWritable();
+
+    // a node cannot be copied because it owns buffer and a pin
+    BTLeafNode(const BTLeafNode&);
+    BTLeafNode& operator=(const BTLeafNode&);
 }; 
 
 
@@ -127,6 +154,13 @@ class BTLeafNode {
  */
 class BTNonLeafNode {
   public:
+   /**
+    * Constructor for a BTNonLeafNode
+    * @param pageSize[IN] the page size of the file of the node
+    */
+   BTNonLeafNode(int pageSize = PageFile::DEFAULT_PAGE_SIZE);
+   ~BTNonLeafNode();
+
    /**
     * Insert a (key, pid) pair to the node.
     * Remember that all keys inside a B+tree node should be kept sorted.
@@ -208,10 +242,35 @@ class BTNonLeafNode {
 
   private:
    /**
-    * The main memory buffer for loading the content of the disk page 
-    * that contains the node.
+    * The content of the node. It points to the page pinned in the
+    * buffer pool until the node is modified, and to buffer afterwards.
+    */
+    const char* page;
+
+   /**
+    * The buffer pool page that the node was read from.
+    */
+    PageHandle handle;
+
+   /**
+    * The main memory buffer for the content of a modified node.
+    * It is allocated when the node is modified for the first time.
     */
-    char buffer[PageFile::PAGE_SIZE];
+    char* buffer;
+
+   /**
+    * The size of the node, i.e., the page size of its file
+    */
+    int pageSize;
+
+   /**
+    * Copy the content of the node to buffer before it is modified.
+    */
+    void makeWritable();
+
+    // a node cannot be copied because it owns buffer and a pin
+    BTNonLeafNode(const BTNonLeafNode&);
+    BTNonLeafNode& operator=(const BTNonLeafNode&);
 
     struct Entry;
 }; 
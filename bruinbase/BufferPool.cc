@@ -0,0 +1,1034 @@
+#include <cstring>
+#include <cstdlib>
+#include <new>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "BufferPool.h"
+#include "AsyncIO.h"
+
+BufferPool* BufferPool::pools[POOL_COUNT] = { NULL };
+long BufferPool::poolSize = DEFAULT_POOL_SIZE;
+long BufferPool::poolBudget = DEFAULT_POOL_SIZE;
+int  BufferPool::poolPartitions = DEFAULT_PARTITION_COUNT;
+BufferPool::Policy BufferPool::poolPolicy = LRU;
+int  BufferPool::poolFlusherInterval = 0;
+std::string BufferPool::warmupFile = "bruinbase.warmup";
+
+static pthread_mutex_t poolLock = PTHREAD_MUTEX_INITIALIZER;
+
+// allocate memory that direct I/O can read into and write from
+static char* allocAligned(long size)
+{
+  void* p;
+  if (posix_memalign(&p, PageFile::IO_ALIGNMENT, size) != 0) throw std::bad_alloc();
+  return (char*) p;
+}
+
+RC BufferPool::init(long size, int partitions, Policy policy)
+{
+  RC rc = 0;
+
+  if (size < PageFile::MAX_PAGE_SIZE || partitions <= 0) return RC_INVALID_ATTRIBUTE;
+
+  pthread_mutex_lock(&poolLock);
+  // the pools cannot be resized once pages have been cached in them
+  for (int i = 0; i < POOL_COUNT; i++) {
+    if (pools[i] != NULL) rc = RC_INVALID_ATTRIBUTE;
+  }
+  if (rc == 0) {
+    poolSize = size;
+    poolBudget = size;
+    poolPartitions = partitions;
+    poolPolicy = policy;
+  }
+  pthread_mutex_unlock(&poolLock);
+
+  return rc;
+}
+
+BufferPool& BufferPool::getPool(int pageSize)
+{
+  int i;
+
+  // the pool of 1KB pages comes first, followed by 2KB, 4KB, ...
+  for (i = 0; (PageFile::DEFAULT_PAGE_SIZE << i) < pageSize; i++);
+
+  // create the pool when the page size is used for the first time
+  if (pools[i] == NULL) {
+    pthread_mutex_lock(&poolLock);
+    if (pools[i] == NULL) {
+      BufferPool* bp = new BufferPool(poolSize, poolPartitions, poolPolicy, pageSize);
+      if (poolFlusherInterval > 0) bp->startFlusher(poolFlusherInterval);
+      pools[i] = bp;
+    }
+    pthread_mutex_unlock(&poolLock);
+  }
+  return *pools[i];
+}
+
+RC BufferPool::startFlushers(int interval)
+{
+  RC rc = 0;
+
+  if (interval <= 0) return RC_INVALID_ATTRIBUTE;
+
+  pthread_mutex_lock(&poolLock);
+  if (poolFlusherInterval > 0) rc = RC_INVALID_ATTRIBUTE;
+  else {
+    poolFlusherInterval = interval;
+    for (int i = 0; i < POOL_COUNT; i++) {
+      if (pools[i] != NULL) pools[i]->startFlusher(interval);
+    }
+  }
+  pthread_mutex_unlock(&poolLock);
+
+  return rc;
+}
+
+BufferPool::BufferPool(long size, int npartitions, Policy policy, int pageSize)
+{
+  long frameCount = size / pageSize;
+
+  // every partition needs at least one frame
+  if (npartitions > frameCount) npartitions = frameCount;
+
+  this->pageSize = pageSize;
+  partitionCount = npartitions;
+  framesPerPartition = frameCount / partitionCount;
+  // keep the hash chains short: one bucket per frame, rounded up to a power of 2
+  for (bucketCount = 1; bucketCount < framesPerPartition; bucketCount <<= 1);
+  flusherInterval = 0;
+
+  // the sizes of a1in and A1out recommended by the 2Q paper
+  this->policy = policy;
+  a1inMax = framesPerPartition / 4;
+  ghostCount = (framesPerPartition / 2 > 0) ? framesPerPartition / 2 : 1;
+
+  // the frames follow each other, so they are aligned to the page size.
+  // the pool can grow to the whole budget, but the memory of a frame is
+  // only used, and charged to the budget, when the frame is first taken
+  memorySize = (long)partitionCount * framesPerPartition * pageSize;
+  void* addr = ::mmap(NULL, memorySize, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+  if (addr == MAP_FAILED) throw std::bad_alloc();
+  memory = (char*) addr;
+  frames = new Frame[partitionCount * framesPerPartition];
+  partitions = new Partition[partitionCount];
+
+  for (int i = 0; i < partitionCount; i++) {
+    Partition& p = partitions[i];
+
+    pthread_mutex_init(&p.lock, NULL);
+    pthread_cond_init(&p.loaded, NULL);
+    pthread_cond_init(&p.written, NULL);
+    p.buckets = new Frame*[bucketCount];
+    memset(p.buckets, 0, sizeof(Frame*) * bucketCount);
+    p.frames = frames + i * framesPerPartition;
+    p.lru.prev = p.lru.next = &p.lru;
+    p.a1in.prev = p.a1in.next = &p.a1in;
+    p.a1inCount = 0;
+    p.fresh.prev = p.fresh.next = &p.fresh;
+    p.charged = 0;
+
+    p.ghosts = new Ghost[ghostCount];
+    p.ghostBuckets = new Ghost*[bucketCount];
+    memset(p.ghostBuckets, 0, sizeof(Ghost*) * bucketCount);
+    for (int j = 0; j < ghostCount; j++) p.ghosts[j].pid = -1;
+    p.ghostNext = 0;
+
+    // all frames start in the list of fresh frames
+    for (int j = 0; j < framesPerPartition; j++) {
+      Frame* f = &p.frames[j];
+      f->pid = -1;
+      f->pinCount = 0;
+      f->dirty = false;
+      f->owner = NULL;
+      f->writer = NULL;
+      f->version = 0;
+      f->inA1 = false;
+      f->loading = false;
+      f->hashNext = NULL;
+      f->data = memory + ((long)i * framesPerPartition + j) * pageSize;
+      pushFront(p.fresh, f);
+    }
+  }
+}
+
+BufferPool::~BufferPool()
+{
+  for (int i = 0; i < partitionCount; i++) {
+    // the frames in use go back to the budget of the pools
+    int n = partitions[i].charged - RESERVED_FRAMES;
+    if (n > 0) __sync_fetch_and_add(&poolBudget, (long)n * pageSize);
+
+    pthread_mutex_destroy(&partitions[i].lock);
+    pthread_cond_destroy(&partitions[i].loaded);
+    pthread_cond_destroy(&partitions[i].written);
+    delete [] partitions[i].buckets;
+    delete [] partitions[i].ghosts;
+    delete [] partitions[i].ghostBuckets;
+  }
+  delete [] partitions;
+  delete [] frames;
+  ::munmap(memory, memorySize);
+}
+
+RC BufferPool::read(const PageFile& pf, PageId pid, void* buffer)
+{
+  RC     rc;
+  Frame* f;
+  Partition& p = partitionOf(pf, pid);
+
+  pthread_mutex_lock(&p.lock);
+  if ((rc = fetch(p, pf, pid, f)) == 0) {
+    memcpy(buffer, f->data, pageSize);
+  }
+  pthread_mutex_unlock(&p.lock);
+
+  return rc;
+}
+
+RC BufferPool::pin(const PageFile& pf, PageId pid, const char*& data, void*& frame)
+{
+  RC     rc;
+  Frame* f;
+  Partition& p = partitionOf(pf, pid);
+
+  pthread_mutex_lock(&p.lock);
+  if ((rc = fetch(p, pf, pid, f)) == 0) {
+    f->pinCount++;
+    data = f->data;
+    frame = f;
+  }
+  pthread_mutex_unlock(&p.lock);
+
+  return rc;
+}
+
+RC BufferPool::prefetch(const PageFile& pf, PageId pid, int count)
+{
+  RC    rc;
+  char* buffers[PageFile::MAX_IO_PAGES];
+
+  if (count <= 0 || count > PageFile::MAX_IO_PAGES) return RC_INVALID_PID;
+
+  // trim the cached pages at both ends of the run
+  for (; count > 0 && contains(pf, pid); pid++, count--);
+  for (; count > 0 && contains(pf, pid + count - 1); count--);
+  if (count == 0) return 0;
+
+  // the pages of the run belong to different partitions, so they are
+  // read into a private buffer without holding any lock, and copied
+  // into their frames afterwards
+  char* block = allocAligned((long)count * pageSize);
+  for (int i = 0; i < count; i++) buffers[i] = block + i * pageSize;
+
+  if ((rc = pf.readPages(pid, count, buffers)) == 0) {
+    for (int i = 0; i < count; i++) install(pf, pid + i, buffers[i]);
+    rc = count;
+  }
+
+  free(block);
+  return rc;
+}
+
+RC BufferPool::prefetch(const PageFile& pf, const PageId* pids, int count)
+{
+  std::vector<PageId> missing;
+  std::vector<AsyncIO::Request> reqs;
+
+  // collect the distinct pages that are not in the pool
+  for (int i = 0; i < count; i++) {
+    if (pids[i] >= 0 && pids[i] < pf.endPid() && !contains(pf, pids[i])) {
+      missing.push_back(pids[i]);
+    }
+  }
+  std::sort(missing.begin(), missing.end());
+  missing.erase(std::unique(missing.begin(), missing.end()), missing.end());
+  if (missing.empty()) return 0;
+
+  // compressed pages are read synchronously, so the runs of consecutive
+  // pages, which usually lie back to back in the file, are read together
+  if (pf.isCompressed()) {
+    int n = 0;
+    for (unsigned i = 0, next; i < missing.size(); i = next) {
+      for (next = i + 1; next < missing.size() && (int)(next - i) < PageFile::MAX_IO_PAGES &&
+                         missing[next] == missing[next - 1] + 1; next++);
+      RC rc = prefetch(pf, missing[i], next - i);
+      if (rc > 0) n += rc;
+    }
+    return n;
+  }
+
+  char* block = allocAligned((long)missing.size() * pageSize);
+  reqs.resize(missing.size());
+  for (unsigned i = 0; i < missing.size(); i++) {
+    reqs[i].pf = &pf;
+    reqs[i].pid = missing[i];
+    reqs[i].buffer = block + i * pageSize;
+  }
+
+  // read all pages at once, and keep the ones that were read
+  AsyncIO::getEngine().read(&reqs[0], reqs.size());
+
+  int n = 0;
+  for (unsigned i = 0; i < reqs.size(); i++) {
+    if (reqs[i].rc == 0) {
+      install(pf, reqs[i].pid, reqs[i].buffer);
+      n++;
+    }
+  }
+
+  free(block);
+  return n;
+}
+
+void BufferPool::unpin(void* frame)
+{
+  Frame* f = (Frame*) frame;
+  Partition& p = partitions[(f - frames) / framesPerPartition];
+
+  pthread_mutex_lock(&p.lock);
+  f->pinCount--;
+  pthread_mutex_unlock(&p.lock);
+}
+
+RC BufferPool::write(const PageFile& pf, PageId pid, const void* buffer)
+{
+  RC rc = 0;
+  Partition& p = partitionOf(pf, pid);
+
+  pthread_mutex_lock(&p.lock);
+
+  Frame* f;
+  for (;;) {
+    // a page being read would be overwritten by the old content on disk,
+    // and a page being written back would reach the disk half updated
+    while ((f = lookup(p, pf, pid)) != NULL && (f->loading || f->writer != NULL)) {
+      pthread_cond_wait(f->loading ? &p.loaded : &p.written, &p.lock);
+    }
+    if (f != NULL) {
+      touch(p, f);
+      break;
+    }
+    // the whole page is overwritten, so a new frame need not be read first
+    if ((rc = allocate(p, pf, pid, f)) < 0) {
+      pthread_mutex_unlock(&p.lock);
+      return rc;
+    }
+    if (rc == 0) break;
+  }
+
+  // the buffer may be the frame itself when an unmodified page is written
+  if (f->data != buffer) memcpy(f->data, buffer, pageSize);
+
+  // the page is written to the disk later, by flush() or on eviction
+  f->dirty = true;
+  f->owner = &pf;
+  f->version++;
+
+  pthread_mutex_unlock(&p.lock);
+  return 0;
+}
+
+RC BufferPool::flush(const PageFile& pf)
+{
+  RC rc = 0;
+  std::vector<PageId> pids;
+
+  // collect the dirty pages of the file
+  for (int i = 0; i < partitionCount; i++) {
+    Partition& p = partitions[i];
+
+    pthread_mutex_lock(&p.lock);
+    for (int j = 0; j < framesPerPartition; j++) {
+      if (p.frames[j].dirty && p.frames[j].owner == &pf) {
+        pids.push_back(p.frames[j].pid);
+      }
+    }
+    pthread_mutex_unlock(&p.lock);
+  }
+
+  // write them in the order of their location in the file.
+  // runs of consecutive pages are written with one vectored write.
+  std::sort(pids.begin(), pids.end());
+
+  unsigned i = 0;
+  while (i < pids.size()) {
+    Frame*      run[PageFile::MAX_IO_PAGES];
+    const char* data[PageFile::MAX_IO_PAGES];
+    unsigned    version[PageFile::MAX_IO_PAGES];
+    int         n = 0;
+
+    // pin the frames of the run, so that they can be written without
+    // holding the partition locks during the I/O
+    for (; i < pids.size() && n < PageFile::MAX_IO_PAGES; i++) {
+      if (n > 0 && pids[i] != run[n-1]->pid + 1) break;
+
+      Partition& p = partitionOf(pf, pids[i]);
+      pthread_mutex_lock(&p.lock);
+      // the flusher may have written the page in the meantime
+      Frame* f = lookup(p, pf, pids[i]);
+      bool dirty = (f != NULL && f->dirty);
+      if (dirty) {
+        f->pinCount++;
+        f->writer = &pf;
+        run[n] = f;
+        data[n] = f->data;
+        version[n++] = f->version;
+      }
+      pthread_mutex_unlock(&p.lock);
+
+      // a page that is already clean ends the run
+      if (!dirty && n > 0) { i++; break; }
+    }
+    if (n == 0) continue;
+
+    RC r = pf.writePages(run[0]->pid, n, data);
+    if (r < 0) rc = r;
+
+    // a page written again during the I/O stays dirty
+    for (int j = 0; j < n; j++) {
+      Frame* f = run[j];
+      Partition& p = partitions[(f - frames) / framesPerPartition];
+      pthread_mutex_lock(&p.lock);
+      if (r == 0 && f->version == version[j]) {
+        f->dirty = false;
+        f->owner = NULL;
+      }
+      f->writer = NULL;
+      f->pinCount--;
+      pthread_cond_broadcast(&p.written);
+      pthread_mutex_unlock(&p.lock);
+    }
+  }
+
+  // another thread may still be writing a page of the file that it took
+  // before the page was written above. pf must not be closed before
+  // that write is done, as the other thread writes through pf
+  for (int i = 0; i < partitionCount; i++) {
+    Partition& p = partitions[i];
+
+    pthread_mutex_lock(&p.lock);
+    for (int j = 0; j < framesPerPartition; j++) {
+      while (p.frames[j].writer == &pf) pthread_cond_wait(&p.written, &p.lock);
+    }
+    pthread_mutex_unlock(&p.lock);
+  }
+
+  return rc;
+}
+
+void BufferPool::discard(const PageFile& pf)
+{
+  for (int i = 0; i < partitionCount; i++) {
+    Partition& p = partitions[i];
+
+    pthread_mutex_lock(&p.lock);
+    for (int j = 0; j < framesPerPartition; j++) {
+      Frame* f = &p.frames[j];
+
+      // a write-back through pf may still be in progress
+      while (f->writer == &pf) pthread_cond_wait(&p.written, &p.lock);
+
+      if (f->owner == &pf) {
+        f->dirty = false;
+        f->owner = NULL;
+      }
+
+      // the unpinned pages of the file go, as they may differ from the
+      // disk. a pinned page is clean and is read by another PageFile
+      if (f->pid >= 0 && f->pinCount == 0 && f->dev == pf.dev && f->ino == pf.ino) {
+        unhash(p, f);
+        f->pid = -1;
+        unlink(p, f);
+        pushBack(p.lru, f);
+      }
+    }
+    pthread_mutex_unlock(&p.lock);
+  }
+}
+
+RC BufferPool::startFlusher(int interval)
+{
+  if (flusherInterval > 0 || interval <= 0) return RC_INVALID_ATTRIBUTE;
+
+  flusherInterval = interval;
+  if (pthread_create(&flusher, NULL, flusherMain, this) != 0) {
+    flusherInterval = 0;
+    return RC_INVALID_ATTRIBUTE;
+  }
+  pthread_detach(flusher);
+
+  return 0;
+}
+
+void* BufferPool::flusherMain(void* arg)
+{
+  BufferPool* bp = (BufferPool*) arg;
+
+  for (;;) {
+    usleep(bp->flusherInterval * 1000);
+
+    // write back the dirty frames in the colder half of each partition,
+    // so that evictions rarely have to wait for a write
+    for (int i = 0; i < bp->partitionCount; i++) {
+      Partition& p = bp->partitions[i];
+
+      std::vector<Frame*> run;
+
+      pthread_mutex_lock(&p.lock);
+      Frame* f = p.lru.prev;
+      for (int n = 0; n < bp->framesPerPartition / 2 && f != &p.lru; n++, f = f->prev) {
+        if (f->dirty && f->pinCount == 0) run.push_back(f);
+      }
+      // the pages in the a1in queue of 2Q are cold by definition. the run
+      // is capped, as its frames are pinned during the I/O, and at least
+      // half of the partition has to stay evictable meanwhile
+      for (f = p.a1in.prev; f != &p.a1in && (int) run.size() < bp->framesPerPartition / 2; f = f->prev) {
+        if (f->dirty && f->pinCount == 0) run.push_back(f);
+      }
+      if (!run.empty()) bp->writeBack(p, &run[0], run.size());
+      pthread_mutex_unlock(&p.lock);
+    }
+  }
+
+  return NULL;
+}
+
+//
+// warm-up persistence
+//
+// the warm-up file lists the cached pages of each file:
+//   file <dev> <ino> <# pages> <name>
+//   <pid>
+//   ...
+// and the pages of the files read in 'm' mode that are resident in the
+// OS page cache, as the pages of a mapping never enter the pools:
+//   mapped <dev> <ino> <# pages> <name>
+//   <pid>
+//   ...
+//
+
+// a cached page, as recorded in the warm-up file
+struct CachedPage {
+  dev_t  dev;
+  ino_t  ino;
+  PageId pid;
+};
+
+static bool operator < (const CachedPage& a, const CachedPage& b)
+{
+  if (a.dev != b.dev) return a.dev < b.dev;
+  if (a.ino != b.ino) return a.ino < b.ino;
+  return a.pid < b.pid;
+}
+
+RC BufferPool::saveWarmup(const std::string& filename)
+{
+  std::vector<CachedPage> pages;
+  std::string tmpname = filename + ".tmp";
+  FILE* file;
+  int   saved = 0;
+
+  // collect the cached pages of all pools
+  for (int i = 0; i < POOL_COUNT; i++) {
+    BufferPool* bp = pools[i];
+    if (bp == NULL) continue;
+    for (int j = 0; j < bp->partitionCount; j++) {
+      Partition& p = bp->partitions[j];
+      pthread_mutex_lock(&p.lock);
+      for (int k = 0; k < bp->framesPerPartition; k++) {
+        if (p.frames[k].pid < 0) continue;
+        CachedPage c = { p.frames[k].dev, p.frames[k].ino, p.frames[k].pid };
+        pages.push_back(c);
+      }
+      pthread_mutex_unlock(&p.lock);
+    }
+  }
+  std::sort(pages.begin(), pages.end());
+
+  // the new list replaces the old one only when it is complete
+  if ((file = fopen(tmpname.c_str(), "w")) == NULL) return RC_FILE_OPEN_FAILED;
+  for (unsigned i = 0, next; i < pages.size(); i = next) {
+    for (next = i + 1; next < pages.size() && pages[next].dev == pages[i].dev &&
+                       pages[next].ino == pages[i].ino; next++);
+
+    // a file never opened by this process cannot be found again
+    std::string name = IOStats::getFileName(pages[i].dev, pages[i].ino);
+    if (name.empty()) continue;
+
+    fprintf(file, "file %lu %lu %u %s\n", (unsigned long) pages[i].dev,
+            (unsigned long) pages[i].ino, next - i, name.c_str());
+    for (unsigned j = i; j < next; j++) fprintf(file, "%d\n", pages[j].pid);
+    saved += next - i;
+  }
+  for (IOStats::FileStats* fs = IOStats::getFiles(); fs != NULL; fs = fs->next) {
+    if (fs->mapped) saved += saveMapped(file, fs);
+  }
+  if (fclose(file) != 0 || rename(tmpname.c_str(), filename.c_str()) < 0) {
+    ::unlink(tmpname.c_str());
+    return RC_FILE_WRITE_FAILED;
+  }
+
+  return saved;
+}
+
+RC BufferPool::startWarmup(const std::string& filename)
+{
+  pthread_t thread;
+  FILE* file;
+
+  warmupFile = filename;
+  if ((file = fopen(filename.c_str(), "r")) == NULL) return RC_FILE_OPEN_FAILED;
+
+  if (pthread_create(&thread, NULL, warmupMain, file) != 0) {
+    fclose(file);
+    return RC_FILE_OPEN_FAILED;
+  }
+  pthread_detach(thread);
+
+  return 0;
+}
+
+int BufferPool::saveMapped(FILE* file, const IOStats::FileStats* fs)
+{
+  PageFile pf;
+  std::vector<unsigned char> resident;
+  std::vector<PageId> pids;
+
+  // the name may refer to another file by now
+  if (pf.open(fs->name, 'm') < 0) return 0;
+  if (pf.map != NULL && pf.dev == fs->dev && pf.ino == fs->ino) {
+    // mincore() tells which memory pages of the mapping are resident.
+    // a page of the file counts if the memory page of its first byte is
+    long memPageSize = ::sysconf(_SC_PAGESIZE);
+    size_t length = pf.offsetOf(pf.epid);
+    resident.resize((length + memPageSize - 1) / memPageSize);
+    if (::mincore(const_cast<char*>(pf.map), length, &resident[0]) == 0) {
+      for (PageId pid = 0; pid < pf.epid; pid++) {
+        if (resident[pf.offsetOf(pid) / memPageSize] & 1) pids.push_back(pid);
+      }
+    }
+  }
+  pf.close();
+
+  if (pids.empty()) return 0;
+  fprintf(file, "mapped %lu %lu %u %s\n", (unsigned long) fs->dev,
+          (unsigned long) fs->ino, (unsigned) pids.size(), fs->name.c_str());
+  for (unsigned i = 0; i < pids.size(); i++) fprintf(file, "%d\n", pids[i]);
+
+  return pids.size();
+}
+
+void* BufferPool::warmupMain(void* arg)
+{
+  FILE* file = (FILE*) arg;
+  unsigned long dev, ino;
+  unsigned count;
+  char  kind[8];
+  char  name[4096];
+  std::vector<PageId> pids;
+
+  while (fscanf(file, "%7s %lu %lu %u %4095[^\n]\n", kind, &dev, &ino, &count, name) == 5) {
+    bool mapped = (strcmp(kind, "mapped") == 0);
+    pids.resize(count);
+    for (unsigned i = 0; i < count; i++) {
+      if (fscanf(file, "%d\n", &pids[i]) != 1) { count = i; break; }
+    }
+
+    // the file may have been deleted or replaced since the list was saved.
+    // the pages of a file that is being written are not read either, as
+    // they would have to be validated against the writer's ones
+    PageFile pf;
+    if (pf.open(name, mapped ? 'm' : 'r') == 0) {
+      if (pf.dev == (dev_t) dev && pf.ino == (ino_t) ino && count > 0) {
+        std::sort(pids.begin(), pids.begin() + count);
+        if (mapped) {
+          // the kernel reads the pages into its cache in the background,
+          // where they stay after the mapping is gone
+          pf.prefetch(&pids[0], count);
+        } else if (!pf.changedSinceOpen()) {
+          getPool(pf.getPageSize()).warmUp(pf, &pids[0], count);
+        }
+      }
+      pf.close();
+    }
+  }
+
+  fclose(file);
+  return NULL;
+}
+
+void BufferPool::warmUp(const PageFile& pf, const PageId* pids, int count)
+{
+  PageId batch[WARMUP_BATCH];
+  int    n = 0;
+
+  // never read more pages than the pool holds
+  if (count > getFrameCount()) count = getFrameCount();
+
+  for (int i = 0, next; i < count; i = next) {
+    // find the run of consecutive pages that starts at pids[i]
+    for (next = i + 1; next < count && next - i < PageFile::MAX_IO_PAGES &&
+                       pids[next] == pids[next - 1] + 1; next++);
+
+    if (next - i > 1) {
+      // a run is read with one vectored read
+      if (pids[next - 1] < pf.endPid()) {
+        RC rc = prefetch(pf, pids[i], next - i);
+        if (rc > 0) IOStats::prefetch(pf.stats, rc);
+      }
+    } else {
+      // single pages are read in parallel batches
+      batch[n++] = pids[i];
+      if (n == WARMUP_BATCH) {
+        RC rc = prefetch(pf, batch, n);
+        if (rc > 0) IOStats::prefetch(pf.stats, rc);
+        n = 0;
+      }
+    }
+  }
+
+  if (n > 0) {
+    RC rc = prefetch(pf, batch, n);
+    if (rc > 0) IOStats::prefetch(pf.stats, rc);
+  }
+}
+
+//
+// helper functions
+//
+
+static inline unsigned hashPage(dev_t dev, ino_t ino, PageId pid)
+{
+  // multiplicative hashing spreads consecutive pids over the partitions
+  return ((unsigned)pid * 2654435761u) ^ ((unsigned)(ino ^ dev) * 40503u);
+}
+
+RC BufferPool::fetch(Partition& p, const PageFile& pf, PageId pid, Frame*& frame)
+{
+  RC rc;
+  Frame* f;
+
+  for (;;) {
+    // another thread is reading the page. wait until it is loaded,
+    // or until the read has failed and the frame is empty again
+    while ((f = lookup(p, pf, pid)) != NULL && f->loading) {
+      pthread_cond_wait(&p.loaded, &p.lock);
+    }
+    if (f != NULL) {
+      touch(p, f);
+      IOStats::hit(pf.stats);
+      frame = f;
+      return 0;
+    }
+
+    // cache miss. load the page into a new frame
+    if ((rc = allocate(p, pf, pid, f)) < 0) return rc;
+    if (rc == 0) break;
+  }
+  IOStats::miss(pf.stats);
+
+  // the frame is pinned, so it is not evicted while the page is read
+  // without the lock, and marked loading, so no other thread uses it
+  f->loading = true;
+  f->pinCount++;
+  pthread_mutex_unlock(&p.lock);
+  rc = pf.readPage(pid, f->data);
+  pthread_mutex_lock(&p.lock);
+  f->loading = false;
+  f->pinCount--;
+  pthread_cond_broadcast(&p.loaded);
+
+  if (rc < 0) {
+    // leave the frame empty at the tail of the LRU list
+    unhash(p, f);
+    f->pid = -1;
+    unlink(p, f);
+    pushBack(p.lru, f);
+    return rc;
+  }
+
+  frame = f;
+  return 0;
+}
+
+RC BufferPool::allocate(Partition& p, const PageFile& pf, PageId pid, Frame*& frame)
+{
+  RC rc;
+  Frame* f;
+
+  for (;;) {
+    if ((f = victim(p)) == NULL) {
+      // the frames pinned by a write-back are free again when it is done.
+      // only frames pinned by their users make the allocation fail
+      if (!writing(p)) return RC_NO_FREE_FRAME;
+      pthread_cond_wait(&p.written, &p.lock);
+      if ((f = lookup(p, pf, pid)) != NULL) {
+        frame = f;
+        return 1;
+      }
+      continue;
+    }
+    if (!f->dirty) break;
+
+    // a dirty page has to be written to the disk before its frame is
+    // reused. the victim may be written again while the lock is released,
+    // so it is chosen again afterwards
+    if ((rc = writeBack(p, &f, 1)) < 0) return rc;
+    if ((f = lookup(p, pf, pid)) != NULL) {
+      frame = f;
+      return 1;
+    }
+  }
+
+  if (f->pid >= 0) {
+    // 2Q remembers the pages that leave a1in without a second reference
+    if (f->inA1) addGhost(p, f);
+    unhash(p, f);
+  }
+  unlink(p, f);
+
+  f->dev = pf.dev;
+  f->ino = pf.ino;
+  f->pid = pid;
+  Frame*& bucket = bucketOf(p, f->dev, f->ino, pid);
+  f->hashNext = bucket;
+  bucket = f;
+
+  if (policy == TWO_Q && !removeGhost(p, pf, pid)) {
+    // a page seen for the first time goes to a1in
+    pushFront(p.a1in, f);
+    f->inA1 = true;
+    p.a1inCount++;
+  } else {
+    // with 2Q, a page referenced again soon after it left a1in
+    // is hot and goes directly to the main LRU list
+    pushFront(p.lru, f);
+  }
+
+  frame = f;
+  return 0;
+}
+
+BufferPool::Frame* BufferPool::victim(Partition& p)
+{
+  Frame* f;
+
+  // use an empty frame first
+  f = p.lru.prev;
+  if (f != &p.lru && f->pid < 0) return f;
+
+  // then a fresh frame, while the pools are within their budget
+  f = p.fresh.next;
+  if (f != &p.fresh && (p.charged < RESERVED_FRAMES || charge())) {
+    p.charged++;
+    return f;
+  }
+
+  // 2Q takes the oldest page of a1in if a1in is over its share
+  if (policy == TWO_Q && p.a1inCount > a1inMax) {
+    for (f = p.a1in.prev; f != &p.a1in && f->pinCount > 0; f = f->prev);
+    if (f != &p.a1in) return f;
+  }
+
+  // otherwise the least recently used frame that is not pinned
+  for (f = p.lru.prev; f != &p.lru && f->pinCount > 0; f = f->prev);
+  if (f != &p.lru) return f;
+
+  for (f = p.a1in.prev; f != &p.a1in && f->pinCount > 0; f = f->prev);
+  if (f != &p.a1in) return f;
+
+  return NULL;
+}
+
+bool BufferPool::writing(Partition& p) const
+{
+  for (int i = 0; i < framesPerPartition; i++) {
+    if (p.frames[i].writer != NULL) return true;
+  }
+  return false;
+}
+
+bool BufferPool::charge()
+{
+  long left;
+
+  // the budget is shared by the pools of all page sizes
+  while ((left = poolBudget) >= pageSize) {
+    if (__sync_bool_compare_and_swap(&poolBudget, left, left - pageSize)) return true;
+  }
+  return false;
+}
+
+void BufferPool::touch(Partition& p, Frame* f)
+{
+  // with 2Q, a page stays in the a1in FIFO however often it is
+  // referenced there. such references are correlated, e.g. several
+  // records read from the same page, and do not make the page hot.
+  if (f->inA1) return;
+
+  unlink(p, f);
+  pushFront(p.lru, f);
+}
+
+BufferPool::Ghost*& BufferPool::ghostBucketOf(Partition& p, dev_t dev, ino_t ino, PageId pid) const
+{
+  return p.ghostBuckets[(hashPage(dev, ino, pid) / partitionCount) & (bucketCount - 1)];
+}
+
+void BufferPool::addGhost(Partition& p, Frame* f)
+{
+  Ghost* g = &p.ghosts[p.ghostNext];
+  p.ghostNext = (p.ghostNext + 1) % ghostCount;
+
+  // the ring is full. forget the oldest ghost
+  if (g->pid >= 0) {
+    Ghost** link = &ghostBucketOf(p, g->dev, g->ino, g->pid);
+    while (*link != g) link = &(*link)->hashNext;
+    *link = g->hashNext;
+  }
+
+  g->dev = f->dev;
+  g->ino = f->ino;
+  g->pid = f->pid;
+  Ghost*& bucket = ghostBucketOf(p, g->dev, g->ino, g->pid);
+  g->hashNext = bucket;
+  bucket = g;
+}
+
+bool BufferPool::removeGhost(Partition& p, const PageFile& pf, PageId pid)
+{
+  Ghost** link = &ghostBucketOf(p, pf.dev, pf.ino, pid);
+
+  for (; *link != NULL; link = &(*link)->hashNext) {
+    Ghost* g = *link;
+    if (g->pid == pid && g->ino == pf.ino && g->dev == pf.dev) {
+      *link = g->hashNext;
+      g->pid = -1;
+      return true;
+    }
+  }
+  return false;
+}
+
+void BufferPool::install(const PageFile& pf, PageId pid, const char* data)
+{
+  Frame* f;
+  Partition& p = partitionOf(pf, pid);
+
+  // the page may be stale if the file has been opened for writing since
+  // pf was opened, e.g., by a LOAD that runs during the warm-up. the check
+  // is done under the lock, as the writer writes the page to the pool
+  pthread_mutex_lock(&p.lock);
+  if (!pf.changedSinceOpen() && lookup(p, pf, pid) == NULL && allocate(p, pf, pid, f) == 0) {
+    memcpy(f->data, data, pageSize);
+  }
+  pthread_mutex_unlock(&p.lock);
+}
+
+RC BufferPool::writeBack(Partition& p, Frame* const* run, int n)
+{
+  RC rc = 0;
+  std::vector<const PageFile*> owner(n);
+  std::vector<unsigned> version(n);
+  std::vector<RC> result(n);
+
+  // pin the frames, so that they can be written without holding the lock,
+  // and mark them with their owner, so that flush() waits for the I/O
+  for (int i = 0; i < n; i++) {
+    run[i]->pinCount++;
+    run[i]->writer = run[i]->owner;
+    owner[i] = run[i]->owner;
+    version[i] = run[i]->version;
+  }
+  pthread_mutex_unlock(&p.lock);
+
+  for (int i = 0; i < n; i++) {
+    result[i] = owner[i]->writePage(run[i]->pid, run[i]->data);
+  }
+
+  // a page written again during the I/O stays dirty
+  pthread_mutex_lock(&p.lock);
+  for (int i = 0; i < n; i++) {
+    Frame* f = run[i];
+    if (result[i] < 0) rc = result[i];
+    else if (f->version == version[i]) {
+      f->dirty = false;
+      f->owner = NULL;
+    }
+    f->writer = NULL;
+    f->pinCount--;
+  }
+  pthread_cond_broadcast(&p.written);
+
+  return rc;
+}
+
+BufferPool::Partition& BufferPool::partitionOf(const PageFile& pf, PageId pid) const
+{
+  return partitions[hashPage(pf.dev, pf.ino, pid) % partitionCount];
+}
+
+BufferPool::Frame*& BufferPool::bucketOf(Partition& p, dev_t dev, ino_t ino, PageId pid) const
+{
+  return p.buckets[(hashPage(dev, ino, pid) / partitionCount) & (bucketCount - 1)];
+}
+
+bool BufferPool::contains(const PageFile& pf, PageId pid)
+{
+  Partition& p = partitionOf(pf, pid);
+
+  pthread_mutex_lock(&p.lock);
+  bool found = (lookup(p, pf, pid) != NULL);
+  pthread_mutex_unlock(&p.lock);
+
+  return found;
+}
+
+BufferPool::Frame* BufferPool::lookup(Partition& p, const PageFile& pf, PageId pid) const
+{
+  Frame* f;
+  for (f = bucketOf(p, pf.dev, pf.ino, pid); f != NULL; f = f->hashNext) {
+    if (f->pid == pid && f->ino == pf.ino && f->dev == pf.dev) break;
+  }
+  return f;
+}
+
+void BufferPool::unhash(Partition& p, Frame* f)
+{
+  Frame** link = &bucketOf(p, f->dev, f->ino, f->pid);
+  while (*link != f) link = &(*link)->hashNext;
+  *link = f->hashNext;
+  f->hashNext = NULL;
+}
+
+void BufferPool::unlink(Partition& p, Frame* f)
+{
+  f->prev->next = f->next;
+  f->next->prev = f->prev;
+
+  if (f->inA1) {
+    f->inA1 = false;
+    p.a1inCount--;
+  }
+}
+
+void BufferPool::pushFront(Frame& head, Frame* f)
+{
+  f->prev = &head;
+  f->next = head.next;
+  head.next->prev = f;
+  head.next = f;
+}
+
+void BufferPool::pushBack(Frame& head, Frame* f)
+{
+  f->prev = head.prev;
+  f->next = &head;
+  head.prev->next = f;
+  head.prev = f;
+}
@@ -0,0 +1,346 @@
+#ifndef BUFFERPOOL_H
+#define BUFFERPOOL_H
+
+#include <string>
+#include <pthread.h>
+#include "Bruinbase.h"
+#include "PageFile.h"
+
+/**
+ * The page cache shared by all PageFiles of the process.
+ * The pool is split into partitions. Each partition has its own lock,
+ * hash table from (file, pid) to frame and LRU list, so threads that
+ * access different pages rarely contend for the same lock.
+ * A file is identified by its device and inode numbers, so its cached
+ * pages stay valid after the PageFile is closed and opened again.
+ *
+ * All frames of a pool have the same size. Each page size in use has
+ * its own pool, created on first use. The pools share the byte budget
+ * given to init(): a frame takes memory from it the first time it is
+ * used, so a pool grows while the others are small, and the pools of
+ * all page sizes together stay within the budget. Each partition may
+ * use RESERVED_FRAMES frames beyond it, so every pool can cache a few
+ * pages even when another one has taken the whole budget.
+ *
+ * Two replacement policies are available. LRU evicts the least recently
+ * used page. TWO_Q (Johnson and Shasha, VLDB'94) admits a page first to
+ * a small FIFO queue, and promotes it to the main LRU list only if it is
+ * referenced again after it has left the FIFO. Pages touched once by a
+ * large table scan then never push out the frequently used pages, such
+ * as the upper levels of a B+tree.
+ *
+ * The list of cached pages can be saved to a warm-up file, on shutdown
+ * or on demand, and read back into the pools by a background thread
+ * when the process starts again, so the first queries after a restart
+ * do not all go to the disk.
+ */
+class BufferPool {
+ public:
+
+  static const int DEFAULT_POOL_SIZE = 64 * 1024 * 1024; // 64MB
+  static const int DEFAULT_PARTITION_COUNT = 16;
+  static const int WARMUP_BATCH = 256;  // # pages read at once by the warm-up
+  static const int RESERVED_FRAMES = 4; // frames per partition outside the budget
+
+  // page replacement policies
+  enum Policy { LRU, TWO_Q };
+
+  /**
+   * set the configuration of the buffer pools of the process.
+   * this function should be called once at startup, before any PageFile
+   * is opened. if it is not called, the pools share DEFAULT_POOL_SIZE bytes.
+   * @param size[IN] the total size of the pools of all page sizes in bytes
+   * @param partitions[IN] the number of lock partitions
+   * @param policy[IN] the page replacement policy
+   * @return error code. 0 if no error
+   */
+  static RC init(long size, int partitions = DEFAULT_PARTITION_COUNT, Policy policy = LRU);
+
+  /**
+   * @param pageSize[IN] the page size of the pool
+   * @return the buffer pool of the process for pages of pageSize bytes
+   */
+  static BufferPool& getPool(int pageSize = PageFile::DEFAULT_PAGE_SIZE);
+
+  /**
+   * start the background threads that write back the dirty pages in
+   * the less recently used half of every pool every interval msec.
+   * the pools created later start their threads as well.
+   * @param interval[IN] the interval between two rounds in msec
+   * @return error code. 0 if no error
+   */
+  static RC startFlushers(int interval);
+
+  /**
+   * save the (file, pid) pairs of the pages cached in all pools, and of
+   * the pages of mapped files resident in the OS page cache, to a warm-up
+   * file. the files are recorded with the names they were opened with,
+   * so relative names must be read from the same directory.
+   * @param filename[IN] the warm-up file
+   * @return # pages saved, or an error code (< 0)
+   */
+  static RC saveWarmup(const std::string& filename);
+
+  /**
+   * save the cached pages to the warm-up file given to startWarmup(),
+   * or to DEFAULT_WARMUP_FILE if startWarmup() has not been called.
+   * @return # pages saved, or an error code (< 0)
+   */
+  static RC saveWarmup() { return saveWarmup(warmupFile); }
+
+  /**
+   * read the pages listed in a warm-up file back into the pools.
+   * the pages are read by a background thread, sorted by file and pid,
+   * runs of consecutive pages with vectored reads and the others in
+   * parallel batches. the pages of a file that was replaced since the
+   * list was saved, or that is opened for writing during the warm-up,
+   * are skipped. the kernel is asked to read the pages of mapped files.
+   * the file becomes the one that saveWarmup() writes by default,
+   * even if it does not exist yet.
+   * @param filename[IN] the warm-up file written by saveWarmup()
+   * @return error code. 0 if the thread is started
+   */
+  static RC startWarmup(const std::string& filename);
+
+  BufferPool(long size, int npartitions, Policy policy, int pageSize);
+  ~BufferPool();
+
+  /**
+   * read the page pid of pf into buffer.
+   * if the page is not in the pool, it is read from the disk first.
+   * @param pf[IN] the PageFile to read from
+   * @param pid[IN] the page to read
+   * @param buffer[OUT] pointer to memory buffer
+   * @return error code. 0 if no error
+   */
+  RC read(const PageFile& pf, PageId pid, void* buffer);
+
+  /**
+   * pin the page pid of pf in the pool and return a pointer to its frame.
+   * a pinned frame is never evicted, so the pointer stays valid until
+   * unpin() is called. use PageHandle instead of calling this directly.
+   * @param pf[IN] the PageFile to read from
+   * @param pid[IN] the page to pin
+   * @param data[OUT] pointer to the page content in the pool
+   * @param frame[OUT] the pinned frame to pass to unpin()
+   * @return error code. 0 if no error
+   */
+  RC pin(const PageFile& pf, PageId pid, const char*& data, void*& frame);
+
+  /**
+   * read a run of consecutive pages of pf into the pool ahead of use.
+   * the pages at the ends of the run that are already in the pool are
+   * not read again. the rest is read with one vectored read.
+   * @param pf[IN] the PageFile to read from
+   * @param pid[IN] the first page of the run
+   * @param count[IN] # pages in the run. at most PageFile::MAX_IO_PAGES
+   * @return # pages read from the disk, or an error code (< 0)
+   */
+  RC prefetch(const PageFile& pf, PageId pid, int count);
+
+  /**
+   * read a batch of pages of pf into the pool ahead of use.
+   * the pages that are not in the pool are read in parallel by AsyncIO.
+   * @param pf[IN] the PageFile to read from
+   * @param pids[IN] the pages to read, in any order
+   * @param count[IN] # pages in pids
+   * @return # pages read from the disk, or an error code (< 0)
+   */
+  RC prefetch(const PageFile& pf, const PageId* pids, int count);
+
+  /**
+   * release a frame pinned by pin().
+   * @param frame[IN] the frame returned by pin()
+   */
+  void unpin(void* frame);
+
+  /**
+   * write buffer to the page pid of pf in the pool.
+   * the frame is marked dirty and written to the disk when it is evicted,
+   * when pf is flushed, or by the background flusher.
+   * @param pf[IN] the PageFile to write to
+   * @param pid[IN] the page to write
+   * @param buffer[IN] the new content of the page
+   * @return error code. 0 if no error
+   */
+  RC write(const PageFile& pf, PageId pid, const void* buffer);
+
+  /**
+   * write all dirty pages of pf to the disk in the order of their pids.
+   * the function returns only after the write-backs of pages of pf by
+   * other threads, e.g., the background flusher, are done as well.
+   * @param pf[IN] the PageFile to flush
+   * @return error code. 0 if no error
+   */
+  RC flush(const PageFile& pf);
+
+  /**
+   * drop the pages of pf from the pool without writing them, e.g., after
+   * a flush of pf has failed. the dirty pages of pf are lost, and the
+   * unpinned pages of its file are read from the disk again when needed.
+   * the function returns after the write-backs through pf are done.
+   * @param pf[IN] the PageFile to drop the pages of
+   */
+  void discard(const PageFile& pf);
+
+  /**
+   * @return the total number of frames in the pool
+   */
+  int getFrameCount() const { return partitionCount * framesPerPartition; }
+
+  /**
+   * @return the size of the frames of the pool
+   */
+  int getPageSize() const { return pageSize; }
+
+ private:
+  struct Frame {
+    dev_t  dev;         // device and inode of the file of the cached page
+    ino_t  ino;
+    PageId pid;         // page id of the cached page. -1 if empty
+    int    pinCount;    // # PageHandles pointing to this frame
+    bool   dirty;       // true if the page has not been written to the disk
+    const PageFile* owner; // the PageFile that wrote the dirty page
+    const PageFile* writer; // the PageFile that a write-back of the page
+                        //   is in progress for. NULL if none
+    unsigned version;   // incremented on every write to the frame
+    bool   inA1;        // true if the frame is in the a1in queue of 2Q
+    bool   loading;     // true while the page is read from the disk
+    Frame* hashNext;    // next frame in the same hash bucket
+    Frame* prev;        // previous frame in the list (more recent)
+    Frame* next;        // next frame in the list (less recent)
+    char*  data;        // the page content
+  };
+
+  // a page recently evicted from the a1in queue of 2Q
+  struct Ghost {
+    dev_t  dev;
+    ino_t  ino;
+    PageId pid;         // -1 if the slot is empty
+    Ghost* hashNext;
+  };
+
+  struct Partition {
+    pthread_mutex_t lock;
+    pthread_cond_t  loaded; // signaled when a frame has been loaded
+    pthread_cond_t  written; // signaled when a write-back has finished
+    Frame*  frames;     // the frames owned by this partition
+    Frame** buckets;    // hash table from (file, pid) to frame
+    Frame   lru;        // head of the circular LRU list.
+                        //   lru.next is the most recently used frame.
+                        //   empty frames are kept at its tail.
+                        //   with 2Q, this is the main queue "Am"
+    Frame   a1in;       // head of the 2Q FIFO of pages referenced once
+    int     a1inCount;  // # frames in a1in
+    Frame   fresh;      // head of the list of the frames never used.
+                        //   their memory is not charged to the budget yet
+    int     charged;    // # frames taken from the fresh list
+    Ghost*  ghosts;     // ring of the pages evicted from a1in ("A1out")
+    Ghost** ghostBuckets; // hash table from (file, pid) to ghost
+    int     ghostNext;  // the next slot of the ring to reuse
+  };
+
+  // the partition that the page belongs to
+  Partition& partitionOf(const PageFile& pf, PageId pid) const;
+
+  // the hash bucket of the page inside a partition
+  Frame*& bucketOf(Partition& p, dev_t dev, ino_t ino, PageId pid) const;
+
+  // find the page in the partition or load it from the disk.
+  // the partition must be locked by the caller. the lock is released
+  // while the page is read, and while other threads read it.
+  RC fetch(Partition& p, const PageFile& pf, PageId pid, Frame*& frame);
+
+  // take a frame for the page, evicting an unpinned frame chosen by the
+  // replacement policy. the partition must be locked by the caller.
+  // the lock is released while a dirty victim is written back, and while
+  // waiting for the write-backs of other threads when all frames are
+  // pinned, so the page may have been loaded by another thread meanwhile.
+  // returns 1 and the frame of the page in that case.
+  RC allocate(Partition& p, const PageFile& pf, PageId pid, Frame*& frame);
+
+  // the frame to evict from the partition, or a fresh frame while the
+  // budget allows. NULL if all frames in use are pinned
+  Frame* victim(Partition& p);
+
+  // true if a write-back of a frame of the partition is in progress.
+  // the partition must be locked by the caller
+  bool writing(Partition& p) const;
+
+  // take the memory of one more frame from the budget of the pools.
+  // false if the budget is used up
+  bool charge();
+
+  // update the replacement state of the partition on a hit
+  void touch(Partition& p, Frame* f);
+
+  // helper functions for the A1out ghost queue of 2Q
+  Ghost*& ghostBucketOf(Partition& p, dev_t dev, ino_t ino, PageId pid) const;
+  void   addGhost(Partition& p, Frame* f);
+  bool   removeGhost(Partition& p, const PageFile& pf, PageId pid);
+
+  // copy a page read from the disk into a new frame, unless it has
+  // been loaded by another thread in the meantime
+  void   install(const PageFile& pf, PageId pid, const char* data);
+
+  // write dirty frames of the partition to the disk. the partition must
+  // be locked by the caller. the frames are pinned and the lock is
+  // released during the I/O. a frame written again meanwhile stays dirty.
+  // the frames are marked with their owner until the I/O is done, so
+  // that flush() can wait for it before the owner is closed
+  RC writeBack(Partition& p, Frame* const* run, int n);
+
+  // start the background flusher thread of the pool
+  RC startFlusher(int interval);
+
+  // the main loop of the background flusher thread
+  static void* flusherMain(void* arg);
+
+  // write the pages of a mapped file that are in the OS page cache to
+  // the warm-up file. returns # pages written
+  static int saveMapped(FILE* file, const IOStats::FileStats* fs);
+
+  // the main function of the warm-up thread. arg is the open warm-up file
+  static void* warmupMain(void* arg);
+
+  // read the sorted pages of pf into the pool
+  void warmUp(const PageFile& pf, const PageId* pids, int count);
+
+  // helper functions for hash table and LRU list maintenance
+  bool   contains(const PageFile& pf, PageId pid);
+  Frame* lookup(Partition& p, const PageFile& pf, PageId pid) const;
+  void   unhash(Partition& p, Frame* f);
+  void   unlink(Partition& p, Frame* f);
+  void   pushFront(Frame& head, Frame* f);
+  void   pushBack(Frame& head, Frame* f);
+
+  int    pageSize;           // the size of a frame
+  int    partitionCount;
+  int    framesPerPartition;
+  int    bucketCount;        // # hash buckets per partition
+  Policy policy;             // the page replacement policy
+  int    a1inMax;            // 2Q: target # frames in a1in per partition
+  int    ghostCount;         // 2Q: # slots in the A1out ring per partition
+  char*  memory;             // the memory backing all frames
+  long   memorySize;         // the size of the mapping of memory
+  Frame* frames;             // all frames. partition i owns the i'th
+                             //   run of framesPerPartition frames
+  Partition* partitions;
+
+  pthread_t flusher;         // the background flusher thread
+  int    flusherInterval;    // msec between two flusher rounds. 0 if not running
+
+  // the pools of the process, one for each page size from
+  // DEFAULT_PAGE_SIZE to MAX_PAGE_SIZE, and their configuration
+  static const int POOL_COUNT = 7;
+  static BufferPool* pools[POOL_COUNT];
+  static long   poolSize;       // the budget given to init()
+  static long   poolBudget;     // # bytes the pools may still take
+  static int    poolPartitions;
+  static Policy poolPolicy;
+  static int    poolFlusherInterval;
+
+  static std::string warmupFile;  // the default warm-up file
+};
+
+#endif // BUFFERPOOL_H
@@ -0,0 +1,92 @@
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <strings.h>
+#include <unistd.h>
+#include "BufferPool.h"
+#include "PageFile.h"
+using namespace std;
+
+//
+// Measures how well point lookups keep their pages in the buffer pool
+// while a large table scan runs alongside them.
+// usage: BufferPoolBench [lru|2q]
+//
+
+static const int POOL_SIZE = 256 * PageFile::DEFAULT_PAGE_SIZE;
+static const int HOT_PAGES = 64;       // e.g., the upper levels of a B+tree
+static const int SCAN_PAGES = 4096;    // a table 16 times larger than the pool
+static const int SCAN_PER_LOOKUP = 8;  // scan pages read between two lookups
+
+static int createFile(const char* name, int pages)
+{
+  PageFile pf;
+  char page[PageFile::DEFAULT_PAGE_SIZE];
+
+  unlink(name);
+  if (pf.open(name, 'w')) return 1;
+  memset(page, 0, PageFile::DEFAULT_PAGE_SIZE);
+  for (int pid = 0; pid < pages; pid++) {
+    *((int *)page) = pid;
+    if (pf.write(pid, page)) return 1;
+  }
+  return pf.close();
+}
+
+// read a random hot page and return 1 if it was not in the pool
+static int lookup(const PageFile& hot)
+{
+  char page[PageFile::DEFAULT_PAGE_SIZE];
+  long long before = PageFile::getPageReadCount();
+
+  hot.read(rand() % HOT_PAGES, page);
+  return PageFile::getPageReadCount() - before;
+}
+
+int main(int argc, char* argv[])
+{
+  BufferPool::Policy policy = BufferPool::LRU;
+  PageFile hot, scan;
+  char page[PageFile::DEFAULT_PAGE_SIZE];
+  int  lookups, misses;
+
+  if (argc > 1 && strcasecmp(argv[1], "2q") == 0) policy = BufferPool::TWO_Q;
+  BufferPool::init(POOL_SIZE, 4, policy);
+
+  if (createFile("bench_hot.dat", HOT_PAGES) || createFile("bench_scan.dat", SCAN_PAGES)) {
+    cout << "Could not create the benchmark files" << endl;
+    return 1;
+  }
+  hot.open("bench_hot.dat", 'r');
+  scan.open("bench_scan.dat", 'r');
+
+  // point lookups alone
+  srand(143);
+  misses = 0;
+  for (lookups = 0; lookups < 10000; lookups++) {
+    misses += lookup(hot);
+  }
+  cout << "lookups only:       " << lookups << " lookups, hit rate "
+       << 100.0 * (lookups - misses) / lookups << "%" << endl;
+
+  // point lookups while the large table is scanned twice
+  misses = 0;
+  lookups = 0;
+  for (int round = 0; round < 2; round++) {
+    for (int pid = 0; pid < SCAN_PAGES; pid++) {
+      scan.read(pid, page);
+      if (pid % SCAN_PER_LOOKUP == 0) {
+        misses += lookup(hot);
+        lookups++;
+      }
+    }
+  }
+  cout << "lookups with scan:  " << lookups << " lookups, hit rate "
+       << 100.0 * (lookups - misses) / lookups << "%" << endl;
+
+  hot.close();
+  scan.close();
+  unlink("bench_hot.dat");
+  unlink("bench_scan.dat");
+  return 0;
+}
@@ -0,0 +1,193 @@
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+#include "BufferPool.h"
+#include "PageFile.h"
+#include "RecordFile.h"
+using namespace std;
+
+//
+// Compares direct I/O with buffered I/O on table scans.
+// Each load file is loaded REPEAT times into a table, and the table is
+// scanned SCANS times in each mode. Each mode scans its own copy of the
+// table, so the modes do not share the pages cached in the buffer pool.
+// After the scans, the pages of the table that are also in the OS page
+// cache, i.e., the pages cached twice, are counted with mincore().
+// usage: DirectIOBench [-r repeat] [load file ...]
+// the default load file is xlarge.del. the files in data/ can be given
+// as well, e.g., DirectIOBench xlarge.del data/*.del
+//
+
+static const int SCANS = 5;
+
+static double now()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+// remove a table and the zone map and dictionary files kept beside it
+static void removeTable(const char* table)
+{
+  string name(table);
+
+  unlink(table);
+  unlink((name + ".zone").c_str());
+  unlink((name + ".dict").c_str());
+}
+
+// load the file repeat times into the table
+static long loadTable(const char* loadfile, const char* table, int repeat)
+{
+  RecordFile rf;
+  RecordId   rid;
+  string     line;
+  long       count = 0;
+
+  removeTable(table);
+  if (rf.open(table, 'w')) return -1;
+  for (int i = 0; i < repeat; i++) {
+    ifstream lf(loadfile);
+    if (!lf.is_open()) return -1;
+    while (getline(lf, line)) {
+      const char* comma = strchr(line.c_str(), ',');
+      if (comma == NULL) continue;
+      if (rf.append(atoi(line.c_str()), string(comma + 1), rid)) return -1;
+      count++;
+    }
+  }
+  rf.close();
+  return count;
+}
+
+static int copyFile(const char* from, const char* to)
+{
+  char buffer[65536];
+  int  in, out;
+  ssize_t n;
+
+  unlink(to);
+  if ((in = open(from, O_RDONLY)) < 0) return 1;
+  if ((out = open(to, O_WRONLY|O_CREAT, 0644)) < 0) { close(in); return 1; }
+  while ((n = read(in, buffer, sizeof(buffer))) > 0) {
+    if (write(out, buffer, n) != n) break;
+  }
+  close(in);
+  close(out);
+  return (n == 0) ? 0 : 1;
+}
+
+// write the file to the disk and drop it from the OS page cache
+static void dropCache(const char* name)
+{
+  int fd = open(name, O_RDONLY);
+  if (fd < 0) return;
+  fdatasync(fd);
+  posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+  close(fd);
+}
+
+// count the pages of the file in the OS page cache, in KB
+static long cachedKB(const char* name)
+{
+  long pageSize = sysconf(_SC_PAGESIZE);
+  long size, pages, resident = 0;
+  int  fd;
+
+  if ((fd = open(name, O_RDONLY)) < 0) return -1;
+  size = lseek(fd, 0, SEEK_END);
+  if (size == 0) { close(fd); return 0; }
+
+  void* addr = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED) return -1;
+
+  pages = (size + pageSize - 1) / pageSize;
+  unsigned char* vec = new unsigned char[pages];
+  if (mincore(addr, size, vec) == 0) {
+    for (long i = 0; i < pages; i++) resident += (vec[i] & 1);
+  }
+  delete [] vec;
+  munmap(addr, size);
+
+  return resident * (pageSize / 1024);
+}
+
+// scan the table SCANS times and report the time and the cached pages
+static void scanTable(const char* table, bool direct)
+{
+  RecordFile rf;
+  RecordId   rid;
+  int        key;
+  string     value;
+  double     first = 0, rest = 0;
+
+  PageFile::setDirectIO(direct);
+  dropCache(table);
+  if (rf.open(table, 'r')) {
+    cout << "Could not open " << table << endl;
+    return;
+  }
+
+  for (int scan = 0; scan < SCANS; scan++) {
+    double begin = now();
+    for (rid.pid = rid.sid = 0; rid < rf.endRid(); rf.next(rid)) {
+      rf.read(rid, key, value);
+    }
+    if (scan == 0) first = now() - begin;
+    else rest += now() - begin;
+  }
+  rf.close();
+
+  printf("  %-9s first scan %8.2f ms, next scans %8.2f ms, OS cache %6ld KB\n",
+         direct ? "direct" : "buffered", first * 1000, rest * 1000 / (SCANS - 1),
+         cachedKB(table));
+}
+
+int main(int argc, char* argv[])
+{
+  int  repeat = 20;
+  int  c;
+
+  while ((c = getopt(argc, argv, "r:")) != -1) {
+    if (c == 'r') repeat = atoi(optarg);
+    else {
+      cerr << "usage: " << argv[0] << " [-r repeat] [load file ...]" << endl;
+      return 1;
+    }
+  }
+
+  // the buffer pool holds the whole table in both modes
+  BufferPool::init(256 * 1024 * 1024);
+
+  const char* defaults[] = { "xlarge.del" };
+  const char** files = (optind < argc) ? (const char**)argv + optind : defaults;
+  int count = (optind < argc) ? argc - optind : 1;
+
+  for (int i = 0; i < count; i++) {
+    // the loaded pages stay in the buffer pool, so both modes scan
+    // copies of the table that have never been read
+    long records = loadTable(files[i], "bench_load.tbl", repeat);
+    if (records < 0 || copyFile("bench_load.tbl", "bench_buffered.tbl") ||
+        copyFile("bench_load.tbl", "bench_direct.tbl")) {
+      cout << "Could not load " << files[i] << endl;
+      continue;
+    }
+    removeTable("bench_load.tbl");
+
+    printf("%s x %d: %ld records\n", files[i], repeat, records);
+    scanTable("bench_buffered.tbl", false);
+    scanTable("bench_direct.tbl", true);
+  }
+
+  removeTable("bench_buffered.tbl");
+  removeTable("bench_direct.tbl");
+  return 0;
+}
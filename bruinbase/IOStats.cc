@@ -0,0 +1,318 @@
+#include <cstring>
+#include <ctime>
+#include <pthread.h>
+#include "IOStats.h"
+
+using std::string;
+
+// the counters of a query. a file gets a slot on its first access in
+// the query. the files beyond the slots only count in the total
+struct IOStats::Query {
+  static const int FILE_SLOTS = 16;
+
+  IOCounters c;
+  FileStats* fs[FILE_SLOTS];  // the file of each slot. set with a CAS
+  IOCounters fc[FILE_SLOTS];  // the counters of the file of each slot
+};
+
+IOStats::FileStats* IOStats::files = NULL;
+IOCounters IOStats::totals;
+IOStats::Query* IOStats::last = NULL;
+
+// the query the thread counts for
+static __thread IOStats::Query* current = NULL;
+
+// protects the list of files. the counters themselves are atomic
+static pthread_mutex_t filesLock = PTHREAD_MUTEX_INITIALIZER;
+
+IOStats::FileStats* IOStats::getFileStats(const string& name, dev_t dev, ino_t ino)
+{
+  FileStats* fs;
+
+  pthread_mutex_lock(&filesLock);
+  for (fs = files; fs != NULL; fs = fs->next) {
+    if (fs->dev == dev && fs->ino == ino) break;
+  }
+  if (fs == NULL) {
+    fs = new FileStats;
+    fs->name = name;
+    fs->dev = dev;
+    fs->ino = ino;
+    memset(&fs->c, 0, sizeof(fs->c));
+    fs->mapped = false;
+    fs->writers = 0;
+    fs->generation = 0;
+    fs->next = files;
+    files = fs;
+  }
+  pthread_mutex_unlock(&filesLock);
+
+  return fs;
+}
+
+string IOStats::getFileName(dev_t dev, ino_t ino)
+{
+  string name;
+
+  pthread_mutex_lock(&filesLock);
+  for (FileStats* fs = files; fs != NULL; fs = fs->next) {
+    if (fs->dev == dev && fs->ino == ino) { name = fs->name; break; }
+  }
+  pthread_mutex_unlock(&filesLock);
+
+  return name;
+}
+
+IOStats::FileStats* IOStats::getFiles()
+{
+  pthread_mutex_lock(&filesLock);
+  FileStats* fs = files;
+  pthread_mutex_unlock(&filesLock);
+
+  return fs;
+}
+
+int IOStats::target(FileStats* fs, IOCounters* c[4])
+{
+  Query* q = current;
+  int n = 0;
+
+  c[n++] = &totals;
+  if (fs != NULL) c[n++] = &fs->c;
+  if (q == NULL) return n;
+
+  c[n++] = &q->c;
+  if (fs == NULL) return n;
+
+  // find the slot of the file, or take a free one
+  for (int i = 0; i < Query::FILE_SLOTS; i++) {
+    FileStats* s = __sync_val_compare_and_swap(&q->fs[i], (FileStats*) NULL, fs);
+    if (s == NULL || s == fs) { c[n++] = &q->fc[i]; break; }
+  }
+  return n;
+}
+
+void IOStats::add(FileStats* fs, long long IOCounters::*counter, long long n)
+{
+  IOCounters* c[4];
+  int count = target(fs, c);
+
+  for (int i = 0; i < count; i++) __sync_fetch_and_add(&(c[i]->*counter), n);
+}
+
+void IOStats::addLatency(FileStats* fs, bool write, long long nsec)
+{
+  IOCounters* c[4];
+  int count = target(fs, c);
+  int b;
+
+  // find the smallest power of 2 usec above the latency
+  long long usec = nsec / 1000;
+  for (b = 0; b < IOCounters::LATENCY_BUCKETS - 1 && usec >= (1LL << b); b++);
+
+  for (int i = 0; i < count; i++) {
+    __sync_fetch_and_add(write ? &c[i]->writeLatency[b] : &c[i]->readLatency[b], 1);
+  }
+}
+
+void IOStats::hit(FileStats* fs)
+{
+  add(fs, &IOCounters::hits, 1);
+}
+
+void IOStats::mapped(FileStats* fs)
+{
+  add(fs, &IOCounters::mapped, 1);
+}
+
+void IOStats::miss(FileStats* fs)
+{
+  add(fs, &IOCounters::misses, 1);
+}
+
+void IOStats::read(FileStats* fs, int pages, long bytes, long long nsec)
+{
+  add(fs, &IOCounters::pagesRead, pages);
+  add(fs, &IOCounters::bytesRead, bytes);
+  add(fs, &IOCounters::readCalls, 1);
+  addLatency(fs, false, nsec);
+}
+
+void IOStats::prefetch(FileStats* fs, int pages)
+{
+  add(fs, &IOCounters::prefetched, pages);
+}
+
+void IOStats::skip(FileStats* fs, int pages, int blocks)
+{
+  add(fs, &IOCounters::skipped, pages);
+  if (blocks > 0) add(fs, &IOCounters::blocksSkipped, blocks);
+}
+
+void IOStats::write(FileStats* fs, int pages, long bytes, long long nsec)
+{
+  add(fs, &IOCounters::pagesWritten, pages);
+  add(fs, &IOCounters::bytesWritten, bytes);
+  add(fs, &IOCounters::writeCalls, 1);
+  addLatency(fs, true, nsec);
+}
+
+long long IOStats::now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (long long) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+void IOStats::beginQuery()
+{
+  Query* q = new Query;
+
+  memset(q, 0, sizeof(*q));
+  current = q;
+}
+
+void IOStats::endQuery()
+{
+  // the threads that worked for the query are done with it by now
+  if (current == NULL) return;
+  delete last;
+  last = current;
+  current = NULL;
+}
+
+IOStats::Query* IOStats::getQuery()
+{
+  return current;
+}
+
+void IOStats::setQuery(Query* q)
+{
+  current = q;
+}
+
+const IOCounters& IOStats::lastQuery()
+{
+  static const IOCounters none = IOCounters();
+
+  return (last != NULL) ? last->c : none;
+}
+
+//
+// print the counters of one row of the table
+//
+static void printRow(FILE* out, const char* name, const IOCounters& c)
+{
+  long long reads = c.hits + c.misses;
+
+  fprintf(out, "%-20s %10lld %10lld %6.1f%% %10lld %10lld %10lld %10lld %10lld %10lld %10lld %10lld %10lld\n",
+          name, c.hits, c.misses, reads ? 100.0 * c.hits / reads : 0.0, c.mapped,
+          c.prefetched, c.bytesRead / 1024, c.bytesWritten / 1024,
+          c.readCalls, c.writeCalls, c.pagesWritten, c.skipped, c.blocksSkipped);
+}
+
+//
+// print the non-empty buckets of a latency histogram
+//
+static void printHistogram(FILE* out, const char* name, const long long* h)
+{
+  fprintf(out, "%s latency (usec):", name);
+  for (int b = 0; b < IOCounters::LATENCY_BUCKETS; b++) {
+    if (h[b] == 0) continue;
+    if (b == IOCounters::LATENCY_BUCKETS - 1) fprintf(out, " >=%lld:%lld", 1LL << (b - 1), h[b]);
+    else fprintf(out, " <%lld:%lld", 1LL << b, h[b]);
+  }
+  fprintf(out, "\n");
+}
+
+void IOStats::print(FILE* out)
+{
+  fprintf(out, "%-20s %10s %10s %7s %10s %10s %10s %10s %10s %10s %10s %10s %10s\n",
+          "file", "hits", "misses", "hit%", "mapped", "prefetched", "KB read", "KB written",
+          "reads", "writes", "pages out", "skipped", "blocks");
+
+  pthread_mutex_lock(&filesLock);
+  for (FileStats* fs = files; fs != NULL; fs = fs->next) {
+    printRow(out, fs->name.c_str(), fs->c);
+  }
+  pthread_mutex_unlock(&filesLock);
+
+  printRow(out, "(total)", totals);
+  printRow(out, "(last query)", lastQuery());
+  for (int i = 0; last != NULL && i < Query::FILE_SLOTS && last->fs[i] != NULL; i++) {
+    printRow(out, ("  " + last->fs[i]->name).c_str(), last->fc[i]);
+  }
+  printHistogram(out, "read", totals.readLatency);
+  printHistogram(out, "write", totals.writeLatency);
+}
+
+//
+// print the counters as the members of a JSON object
+//
+static void dumpCounters(FILE* out, const IOCounters& c)
+{
+  fprintf(out, "\"hits\": %lld, \"misses\": %lld, \"mapped\": %lld, \"prefetched\": %lld, "
+          "\"pages_read\": %lld, \"pages_written\": %lld, "
+          "\"bytes_read\": %lld, \"bytes_written\": %lld, "
+          "\"read_calls\": %lld, \"write_calls\": %lld, \"pages_skipped\": %lld, \"blocks_skipped\": %lld",
+          c.hits, c.misses, c.mapped, c.prefetched, c.pagesRead, c.pagesWritten,
+          c.bytesRead, c.bytesWritten, c.readCalls, c.writeCalls, c.skipped,
+          c.blocksSkipped);
+
+  fprintf(out, ", \"read_latency_us\": [");
+  for (int b = 0; b < IOCounters::LATENCY_BUCKETS; b++) {
+    fprintf(out, b ? ", %lld" : "%lld", c.readLatency[b]);
+  }
+  fprintf(out, "], \"write_latency_us\": [");
+  for (int b = 0; b < IOCounters::LATENCY_BUCKETS; b++) {
+    fprintf(out, b ? ", %lld" : "%lld", c.writeLatency[b]);
+  }
+  fprintf(out, "]");
+}
+
+//
+// print a file name as a JSON string. a name is given by the user
+// in a LOAD or a SELECT, so it may hold quotes or control characters
+//
+static void dumpName(FILE* out, const string& name)
+{
+  fputc('"', out);
+  for (unsigned i = 0; i < name.size(); i++) {
+    unsigned char ch = name[i];
+    if (ch == '"' || ch == '\\') fprintf(out, "\\%c", ch);
+    else if (ch < 0x20) fprintf(out, "\\u%04x", ch);
+    else fputc(ch, out);
+  }
+  fputc('"', out);
+}
+
+void IOStats::dump(FILE* out)
+{
+  bool first = true;
+
+  fprintf(out, "{\"files\": [");
+  pthread_mutex_lock(&filesLock);
+  for (FileStats* fs = files; fs != NULL; fs = fs->next) {
+    fprintf(out, "%s\n  {\"name\": ", first ? "" : ",");
+    dumpName(out, fs->name);
+    fprintf(out, ", ");
+    dumpCounters(out, fs->c);
+    fprintf(out, "}");
+    first = false;
+  }
+  pthread_mutex_unlock(&filesLock);
+
+  fprintf(out, "],\n \"total\": {");
+  dumpCounters(out, totals);
+  fprintf(out, "},\n \"last_query\": {");
+  dumpCounters(out, lastQuery());
+  fprintf(out, ", \"files\": [");
+  for (int i = 0; last != NULL && i < Query::FILE_SLOTS && last->fs[i] != NULL; i++) {
+    fprintf(out, "%s\n  {\"name\": ", i ? "," : "");
+    dumpName(out, last->fs[i]->name);
+    fprintf(out, ", ");
+    dumpCounters(out, last->fc[i]);
+    fprintf(out, "}");
+  }
+  fprintf(out, "]}}\n");
+}
@@ -0,0 +1,203 @@
+#ifndef IOSTATS_H
+#define IOSTATS_H
+
+#include <cstdio>
+#include <string>
+#include <sys/types.h>
+#include "Bruinbase.h"
+
+/**
+ * I/O counters of a file, of a query, or of the whole process.
+ * All counters are 64-bit and updated atomically.
+ */
+struct IOCounters {
+  // latency histogram bucket i counts the system calls that took
+  // less than 2^i usec. the last bucket counts all slower calls
+  static const int LATENCY_BUCKETS = 24;
+
+  long long hits;        // page reads served from the buffer pool
+  long long misses;      // page reads that missed the buffer pool
+  long long mapped;      // page reads of a memory-mapped file. the kernel
+                         //   may have had to read the page from the disk
+  long long prefetched;  // pages read from the disk ahead of use
+  long long pagesRead;   // pages read from the disk
+  long long pagesWritten;// pages written to the disk
+  long long bytesRead;
+  long long bytesWritten;
+  long long readCalls;   // # system calls that read the file
+  long long writeCalls;  // # system calls that wrote the file
+  long long skipped;     // pages a scan did not read, because the
+                         //   summary of their records ruled them out
+  long long blocksSkipped; // blocks of pages a scan did not read, because
+                         //   their value filter ruled the value out
+  long long readLatency[LATENCY_BUCKETS];
+  long long writeLatency[LATENCY_BUCKETS];
+};
+
+/**
+ * The I/O statistics of the process.
+ * PageFile, BufferPool and AsyncIO report every page access here.
+ * The counters are kept per file, identified by its device and inode,
+ * for the whole process, and for the last query. A query only counts the
+ * accesses of its own thread and of the threads that work for it, so the
+ * flusher and the cache warm-up do not add to it.
+ */
+class IOStats {
+ public:
+
+  // the counters of a file. a PageFile gets it when it is opened
+  struct FileStats {
+    std::string name;    // the name the file was first opened with
+    dev_t       dev;
+    ino_t       ino;
+    IOCounters  c;
+    bool        mapped;  // true once the file has been mapped in 'm' mode
+    int         writers; // # PageFiles that have the file open for writing
+    unsigned    generation; // incremented when the file is opened for writing
+    FileStats*  next;
+  };
+
+  /**
+   * find or create the counters of a file.
+   * @param name[IN] the name of the file
+   * @param dev[IN] the device of the file
+   * @param ino[IN] the inode of the file
+   * @return the counters of the file. they exist until the process exits
+   */
+  static FileStats* getFileStats(const std::string& name, dev_t dev, ino_t ino);
+
+  /**
+   * @param dev[IN] the device of a file
+   * @param ino[IN] the inode of a file
+   * @return the name the file was opened with. empty if it was never opened
+   */
+  static std::string getFileName(dev_t dev, ino_t ino);
+
+  /**
+   * @return the counters of all files opened by the process, linked by
+   *         next. files are only added at the head, so the list can be
+   *         walked without a lock
+   */
+  static FileStats* getFiles();
+
+  // the counters of a query, in total and per file
+  struct Query;
+
+  /**
+   * count a page read served from the buffer pool.
+   * @param fs[IN] the counters of the file
+   */
+  static void hit(FileStats* fs);
+
+  /**
+   * count a page read of a memory-mapped file.
+   * @param fs[IN] the counters of the file
+   */
+  static void mapped(FileStats* fs);
+
+  /**
+   * count a page read that missed the buffer pool.
+   * @param fs[IN] the counters of the file
+   */
+  static void miss(FileStats* fs);
+
+  /**
+   * count a system call that read pages from the disk.
+   * @param fs[IN] the counters of the file
+   * @param pages[IN] # pages read
+   * @param bytes[IN] # bytes read
+   * @param nsec[IN] the latency of the call in nsec
+   */
+  static void read(FileStats* fs, int pages, long bytes, long long nsec);
+
+  /**
+   * count pages read ahead of use, by readahead or a batch prefetch.
+   * @param fs[IN] the counters of the file
+   * @param pages[IN] # pages prefetched
+   */
+  static void prefetch(FileStats* fs, int pages);
+
+  /**
+   * count pages a scan skipped without reading them.
+   * @param fs[IN] the counters of the file
+   * @param pages[IN] # pages skipped
+   * @param blocks[IN] # blocks of the pages skipped by a value filter
+   */
+  static void skip(FileStats* fs, int pages, int blocks = 0);
+
+  /**
+   * count a system call that wrote pages to the disk.
+   * @param fs[IN] the counters of the file
+   * @param pages[IN] # pages written
+   * @param bytes[IN] # bytes written
+   * @param nsec[IN] the latency of the call in nsec
+   */
+  static void write(FileStats* fs, int pages, long bytes, long long nsec);
+
+  /**
+   * @return the current time in nsec, to measure latencies
+   */
+  static long long now();
+
+  /**
+   * @return the counters of the whole process
+   */
+  static const IOCounters& total() { return totals; }
+
+  /**
+   * mark the start and the end of a query run by the calling thread.
+   * the accesses of the thread between the two calls are counted for
+   * the query, in total and per file.
+   */
+  static void beginQuery();
+  static void endQuery();
+
+  /**
+   * @return the query the calling thread counts for. NULL if none
+   */
+  static Query* getQuery();
+
+  /**
+   * let the calling thread count for a query, e.g., a thread that
+   * works for the query of another thread.
+   * @param q[IN] the query. NULL to stop counting for a query
+   */
+  static void setQuery(Query* q);
+
+  /**
+   * @return the counters of the last query that ended
+   */
+  static const IOCounters& lastQuery();
+
+  /**
+   * print the counters of every file, of the process and of the last
+   * query as a table for humans.
+   * @param out[IN] the stream to print to
+   */
+  static void print(FILE* out);
+
+  /**
+   * print the same counters as a JSON object for programs.
+   * @param out[IN] the stream to print to
+   */
+  static void dump(FILE* out);
+
+ private:
+  // add n to a counter of a file, of the process, and of the
+  // query of the calling thread
+  static void add(FileStats* fs, long long IOCounters::*counter, long long n);
+
+  // count a system call in the read or write latency histograms
+  // of a file, of the process, and of the query of the calling thread
+  static void addLatency(FileStats* fs, bool write, long long nsec);
+
+  // find the counters to add to for an access of a file
+  // @return # counters stored in c
+  static int target(FileStats* fs, IOCounters* c[4]);
+
+  static FileStats* files;   // the counters of all files
+  static IOCounters totals;  // the counters of the process
+  static Query* last;        // the last query that ended
+};
+
+#endif // IOSTATS_H
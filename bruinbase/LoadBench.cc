@@ -0,0 +1,151 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <sys/time.h>
+#include "BufferPool.h"
+#include "IOStats.h"
+#include "RecordFile.h"
+using namespace std;
+
+//
+// Compares RecordFile::append() with RecordFile::BulkAppender on loads.
+// Each load file is parsed once, and its records are loaded REPEAT times
+// into a new table with each appender and record format. The time
+// includes closing the table, i.e., writing its pages to the disk.
+// usage: LoadBench [-r repeat] [load file ...]
+// the default load files are xlarge.del and ../data/movieactor1.del
+//
+
+struct Record {
+  int    key;
+  string value;
+};
+
+static double now()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static int readLoadFile(const char* loadfile, vector<Record>& records)
+{
+  ifstream lf(loadfile);
+  string   line;
+  Record   r;
+
+  if (!lf.is_open()) return 1;
+  while (getline(lf, line)) {
+    // the value follows the comma, and its quotes are dropped
+    const char* comma = strchr(line.c_str(), ',');
+    if (comma == NULL) continue;
+    r.key = atoi(line.c_str());
+    r.value.assign(comma + 1);
+    if (r.value.size() >= 2 && r.value[0] == '"') r.value = r.value.substr(1, r.value.size() - 2);
+    records.push_back(r);
+  }
+  return 0;
+}
+
+// remove a table and the zone map and dictionary files kept beside it
+static void removeTable(const char* table)
+{
+  string name(table);
+
+  unlink(table);
+  unlink((name + ".zone").c_str());
+  unlink((name + ".dict").c_str());
+}
+
+// load the records repeat times into a new table, and report the time
+static void loadTable(const vector<Record>& records, int repeat,
+                      RecordFile::Format format, bool bulk)
+{
+  const char* table = "bench_load.tbl";
+  RecordFile  rf;
+  RecordId    rid;
+  long long   accesses, written;
+  RC          rc = 0;
+
+  removeTable(table);
+  IOCounters before = IOStats::total();
+  double begin = now();
+
+  if (rf.open(table, 'w', 0, false, format)) {
+    cout << "Could not create " << table << endl;
+    return;
+  }
+  if (bulk) {
+    RecordFile::BulkAppender appender(rf);
+    for (int i = 0; i < repeat && rc == 0; i++) {
+      for (unsigned j = 0; j < records.size() && rc == 0; j++) {
+        rc = appender.append(records[j].key, records[j].value, rid);
+      }
+    }
+    if (rc == 0) rc = appender.flush();
+  } else {
+    for (int i = 0; i < repeat && rc == 0; i++) {
+      for (unsigned j = 0; j < records.size() && rc == 0; j++) {
+        rc = rf.append(records[j].key, records[j].value, rid);
+      }
+    }
+  }
+  PageId pages = rf.endRid().pid + (rf.endRid().sid > 0);
+  rf.close();
+
+  double elapsed = now() - begin;
+  IOCounters after = IOStats::total();
+  accesses = (after.hits + after.mapped + after.misses) - (before.hits + before.mapped + before.misses);
+  written = after.pagesWritten - before.pagesWritten;
+
+  if (rc < 0) {
+    cout << "Could not load the table: error " << rc << endl;
+    return;
+  }
+  printf("  %-8s %-13s %8.2f ms, %10.0f records/s, %6d pages, "
+         "%8lld page reads, %6lld pages written\n",
+         format == RecordFile::SLOTTED ? "slotted" : "fixed",
+         bulk ? "BulkAppender" : "append()", elapsed * 1000,
+         records.size() * repeat / elapsed, pages, accesses, written);
+  removeTable(table);
+}
+
+int main(int argc, char* argv[])
+{
+  int  repeat = 10;
+  int  c;
+
+  while ((c = getopt(argc, argv, "r:")) != -1) {
+    if (c == 'r') repeat = atoi(optarg);
+    else {
+      cerr << "usage: " << argv[0] << " [-r repeat] [load file ...]" << endl;
+      return 1;
+    }
+  }
+
+  BufferPool::init(64 * 1024 * 1024);
+
+  const char* defaults[] = { "xlarge.del", "../data/movieactor1.del" };
+  const char** files = (optind < argc) ? (const char**)argv + optind : defaults;
+  int count = (optind < argc) ? argc - optind : 2;
+
+  for (int i = 0; i < count; i++) {
+    vector<Record> records;
+    if (readLoadFile(files[i], records)) {
+      cout << "Could not read " << files[i] << endl;
+      continue;
+    }
+
+    printf("%s x %d: %ld records\n", files[i], repeat, (long) records.size() * repeat);
+    loadTable(records, repeat, RecordFile::FIXED, false);
+    loadTable(records, repeat, RecordFile::FIXED, true);
+    loadTable(records, repeat, RecordFile::SLOTTED, false);
+    loadTable(records, repeat, RecordFile::SLOTTED, true);
+  }
+
+  return 0;
+}
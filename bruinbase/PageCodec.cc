@@ -0,0 +1,146 @@
+#include <cstring>
+#include "PageCodec.h"
+
+//
+// A compressed page is a sequence of
+//   token    : the literal length in the high 4 bits, and the copy
+//              length - MIN_MATCH in the low 4 bits. 15 means that the
+//              length continues in the following bytes, each adding
+//              up to 255, until a byte is not 255
+//   literals : the bytes to copy from the compressed page
+//   offset   : 2 bytes, little endian. the copy starts this many bytes
+//              before the end of the output so far
+// the last sequence has only literals, and ends the page.
+//
+
+static const int MIN_MATCH = 4;         // the shortest copy
+static const int MAX_OFFSET = 65535;    // the farthest copy
+static const int HASH_BITS = 12;        // the size of the match table
+
+static inline unsigned read32(const char* p)
+{
+  unsigned v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+static inline unsigned hash32(unsigned v)
+{
+  return (v * 2654435761u) >> (32 - HASH_BITS);
+}
+
+// write a length that continues after its 4 bits in the token
+static inline char* putLength(char* op, int n)
+{
+  for (; n >= 255; n -= 255) *op++ = (char) 255;
+  *op++ = (char) n;
+  return op;
+}
+
+// write a sequence. copy is 0 for the last sequence
+static char* putSequence(char* op, const char* lit, int litLength, int offset, int copy)
+{
+  int m = copy ? copy - MIN_MATCH : 0;
+  char* token = op++;
+
+  *token = (char)(((litLength < 15 ? litLength : 15) << 4) | (m < 15 ? m : 15));
+  if (litLength >= 15) op = putLength(op, litLength - 15);
+  memcpy(op, lit, litLength);
+  op += litLength;
+
+  if (copy) {
+    *op++ = (char)(offset & 0xff);
+    *op++ = (char)(offset >> 8);
+    if (m >= 15) op = putLength(op, m - 15);
+  }
+  return op;
+}
+
+int PageCodec::compress(const char* src, int length, char* dst, int capacity)
+{
+  int table[1 << HASH_BITS];
+  int anchor = 0;       // the first byte not written yet
+  char* op = dst;
+
+  for (int i = 0; i < (1 << HASH_BITS); i++) table[i] = -1;
+
+  for (int i = 0; i + MIN_MATCH <= length; ) {
+    unsigned v = read32(src + i);
+    unsigned h = hash32(v);
+    int ref = table[h];
+    table[h] = i;
+
+    if (ref < 0 || i - ref > MAX_OFFSET || read32(src + ref) != v) {
+      i++;
+      continue;
+    }
+
+    // extend the match as far as it goes
+    int copy = MIN_MATCH;
+    while (i + copy < length && src[ref + copy] == src[i + copy]) copy++;
+
+    // a sequence takes at most 1 + literals + 2 + lengths bytes
+    int lit = i - anchor;
+    if ((op - dst) + lit + 3 + lit / 255 + copy / 255 + 2 > capacity) return 0;
+    op = putSequence(op, src + anchor, lit, i - ref, copy);
+
+    i += copy;
+    anchor = i;
+  }
+
+  // the rest of the page is the last literal run
+  int lit = length - anchor;
+  if ((op - dst) + lit + 1 + lit / 255 + 1 > capacity) return 0;
+  op = putSequence(op, src + anchor, lit, 0, 0);
+
+  return op - dst;
+}
+
+RC PageCodec::decompress(const char* src, int length, char* dst, int pageSize)
+{
+  const unsigned char* ip = (const unsigned char*) src;
+  const unsigned char* end = ip + length;
+  char* op = dst;
+  char* oend = dst + pageSize;
+
+  while (ip < end) {
+    int token = *ip++;
+
+    // the literal run
+    int lit = token >> 4;
+    if (lit == 15) {
+      int b;
+      do {
+        if (ip >= end) return RC_INVALID_FILE_FORMAT;
+        b = *ip++;
+        lit += b;
+      } while (b == 255);
+    }
+    if (lit > end - ip || lit > oend - op) return RC_INVALID_FILE_FORMAT;
+    memcpy(op, ip, lit);
+    ip += lit;
+    op += lit;
+
+    // the last sequence has no copy
+    if (ip >= end) break;
+
+    // the copy. it may overlap its own output, e.g., for a run of zeros
+    if (end - ip < 2) return RC_INVALID_FILE_FORMAT;
+    int offset = ip[0] | (ip[1] << 8);
+    ip += 2;
+    int copy = token & 15;
+    if (copy == 15) {
+      int b;
+      do {
+        if (ip >= end) return RC_INVALID_FILE_FORMAT;
+        b = *ip++;
+        copy += b;
+      } while (b == 255);
+    }
+    copy += MIN_MATCH;
+    if (offset == 0 || offset > op - dst || copy > oend - op) return RC_INVALID_FILE_FORMAT;
+    for (const char* from = op - offset; copy > 0; copy--) *op++ = *from++;
+  }
+
+  return (op == oend) ? 0 : RC_INVALID_FILE_FORMAT;
+}
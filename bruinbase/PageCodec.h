@@ -0,0 +1,38 @@
+#ifndef PAGECODEC_H
+#define PAGECODEC_H
+
+#include "Bruinbase.h"
+
+/**
+ * The codec of compressed pages.
+ * It is a byte-oriented LZ77 codec in the style of LZ4: a page is a
+ * sequence of literal runs, each followed by a copy of earlier bytes.
+ * It needs no external library, and it is fast enough to run on every
+ * page read and write. The zero padding of record slots, which fills
+ * most of a table page, becomes a few bytes of copies.
+ */
+class PageCodec {
+ public:
+  /**
+   * compress a page.
+   * @param src[IN] the page to compress
+   * @param length[IN] the size of the page in bytes
+   * @param dst[OUT] the memory to write the compressed page to
+   * @param capacity[IN] the size of dst in bytes
+   * @return the size of the compressed page. 0 if it needs more than
+   *         capacity bytes, i.e., the page does not compress
+   */
+  static int compress(const char* src, int length, char* dst, int capacity);
+
+  /**
+   * decompress a page.
+   * @param src[IN] the compressed page
+   * @param length[IN] the size of the compressed page in bytes
+   * @param dst[OUT] the memory to write the page to
+   * @param pageSize[IN] the size of the page in bytes
+   * @return error code. 0 if no error
+   */
+  static RC decompress(const char* src, int length, char* dst, int pageSize);
+};
+
+#endif // PAGECODEC_H
@@ -7,38 +7,92 @@
  * @date 3/24/2008
  */
 
+#include <cstring>
+#include <cstdlib>
 #include "Bruinbase.h"
 #include "PageFile.h"
+#include "BufferPool.h"
+#include "PageCodec.h"
 #include <fcntl.h>
+#include <unistd.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
 
 using std::string;
 
-int PageFile::readCount = 0;
-int PageFile::writeCount = 0;
-int PageFile::cacheClock = 1;
-struct PageFile::cacheStruct PageFile::readCache[PageFile::CACHE_COUNT];
+bool PageFile::directIO = false;
+
+//
+// the header at the beginning of a file whose page size is not
+// DEFAULT_PAGE_SIZE or whose pages are compressed.
+// the rest of the header page is zero
+//
+struct FileHeader {
+  int magic;       // FILE_MAGIC. a file without a header has a small
+                   //   number here, e.g., # records in the first page
+  int version;     // the version of the header format
+  int pageSize;    // the size of the pages of the file
+  int freeHead;    // the first page of the free-page list. -1 if empty.
+                   //   version 2 and later
+  int flags;       // FILE_COMPRESSED. version 3 and later
+  int dirPages;    // # pages in the page directory of a compressed file
+  long long dirOffset; // the location of the page directory
+  int format;      // the page format of the user of the file.
+                   //   version 4 and later
+};
+
+static const int FILE_MAGIC = 0x42425046;   // "BBPF"
+static const int FILE_VERSION = 4;
+static const int FILE_COMPRESSED = 1;     // the pages are compressed
 
 PageFile::PageFile() 
 { 
   fd = -1; 
   epid = 0; 
+  map = NULL;
+  pageSize = DEFAULT_PAGE_SIZE;
+  base = 0;
+  raWindow = 0;
+  stats = NULL;
+  compressed = false;
+  format = 0;
+  pthread_mutex_init(&allocLock, NULL);
+  pthread_mutex_init(&raLock, NULL);
 }
 
 PageFile::PageFile(const string& filename, char mode)
 {
   fd = -1;
   epid = 0;
+  map = NULL;
+  pageSize = DEFAULT_PAGE_SIZE;
+  base = 0;
+  raWindow = 0;
+  stats = NULL;
+  compressed = false;
+  pthread_mutex_init(&allocLock, NULL);
+  pthread_mutex_init(&raLock, NULL);
   open(filename.c_str(), mode);
 }
 
-RC PageFile::open(const string& filename, char mode)
+PageFile::~PageFile()
+{
+  // dirty pages in the buffer pool must reach the disk
+  if (fd > 0) close();
+  pthread_mutex_destroy(&allocLock);
+  pthread_mutex_destroy(&raLock);
+}
+
+RC PageFile::open(const string& filename, char mode, int pageSize, bool compress)
 {
   RC   rc;
   int  oflag;
   struct stat statbuf;
 
   if (fd > 0) return RC_FILE_OPEN_FAILED;
+  if (pageSize == 0) pageSize = DEFAULT_PAGE_SIZE;
+  if (!isValidPageSize(pageSize)) return RC_INVALID_ATTRIBUTE;
 
   // set the unix file flag depending on the file mode
   switch (mode) {
@@ -50,6 +104,10 @@ RC PageFile::open(const string& filename, char mode)
   case 'W':
     oflag = (O_RDWR|O_CREAT);
     break;
+  case 'm':
+  case 'M':
+    oflag = O_RDONLY;
+    break;
   default:
     return RC_INVALID_FILE_MODE;
   }
@@ -61,31 +119,126 @@ RC PageFile::open(const string& filename, char mode)
   // get the size of the file to set the end pid
   rc = ::fstat(fd, &statbuf);
   if (rc < 0) { ::close(fd); fd = -1; return RC_FILE_OPEN_FAILED; }
-  epid = statbuf.st_size / PAGE_SIZE;
+  dev = statbuf.st_dev;
+  ino = statbuf.st_ino;
+  readOnly = (oflag == O_RDONLY);
+  direct = false;
+  stats = IOStats::getFileStats(filename, dev, ino);
+
+  if (statbuf.st_size == 0) {
+    // a new file. write the header unless the page size is the default
+    // and the pages are not compressed
+    this->pageSize = readOnly ? DEFAULT_PAGE_SIZE : pageSize;
+    compressed = !readOnly && compress;
+    format = 0;
+    base = 0;
+    freeHead = -1;
+    epid = 0;
+    if (this->pageSize != DEFAULT_PAGE_SIZE || compressed) {
+      base = this->pageSize;
+      dataEnd = base;
+      dirOffset = base;
+      dirCount = 0;
+      if ((rc = writeHeader()) < 0) { ::close(fd); fd = -1; return rc; }
+    }
+  } else {
+    // an existing file. a file without a header has 1KB pages
+    FileHeader header;
+    if (::pread(fd, &header, sizeof(header), 0) == sizeof(header) &&
+        header.magic == FILE_MAGIC) {
+      if (header.version < 1 || header.version > FILE_VERSION ||
+          !isValidPageSize(header.pageSize)) {
+        ::close(fd); fd = -1; return RC_INVALID_FILE_FORMAT;
+      }
+      this->pageSize = header.pageSize;
+      base = header.pageSize;
+      // version 1 had no free-page list, version 2 no compression,
+      // and version 3 no page format
+      freeHead = (header.version >= 2) ? header.freeHead : -1;
+      compressed = (header.version >= 3) && (header.flags & FILE_COMPRESSED);
+      format = (header.version >= 4) ? header.format : 0;
+      if (compressed && (rc = readDirectory(header.dirOffset, header.dirPages)) < 0) {
+        ::close(fd); fd = -1; return rc;
+      }
+    } else {
+      this->pageSize = DEFAULT_PAGE_SIZE;
+      base = 0;
+      freeHead = -1;
+      compressed = false;
+      format = 0;
+    }
+    if (!compressed) {
+      epid = (statbuf.st_size > base) ? (statbuf.st_size - base) / this->pageSize : 0;
+    }
+  }
+  allocEnd = epid;
+  dirDirty = false;
+  headerDirty = false;
+
+  // readahead is done only for read-only files. in 'w' mode, a prefetched
+  // page could overwrite a newer version written back during the prefetch
+  raLast = -1;
+  raNext = 0;
+  raWindow = readOnly ? MIN_READAHEAD : 0;
+
+  // in 'm' mode, map the whole file and serve the pages from the mapping.
+  // compressed pages cannot be read in place, so they go through the pool
+  if ((mode == 'm' || mode == 'M') && epid > 0 && !compressed) {
+    void* addr = ::mmap(NULL, offsetOf(epid), PROT_READ, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) { ::close(fd); fd = -1; return RC_FILE_OPEN_FAILED; }
+    map = (const char*) addr;
+  }
+
+  // the header is read and written before O_DIRECT is set,
+  // so it does not need an aligned buffer. compressed pages are
+  // not aligned in the file, so they are never read directly
+  if (directIO && mode != 'm' && mode != 'M' && !compressed) enableDirect();
+
+  // the warm-up of the buffer pool skips the files that are written,
+  // and restores the resident pages of the mapped ones
+  if (!readOnly) {
+    __sync_fetch_and_add(&stats->writers, 1);
+    __sync_fetch_and_add(&stats->generation, 1);
+  }
+  if (map != NULL) stats->mapped = true;
+  generation = stats->generation;
 
   return 0;
 }
 
 RC PageFile::close()
 {
+  RC rc;
+
   if (fd <= 0) return RC_FILE_CLOSE_FAILED;
 
-  // close the file
-  if (::close(fd) < 0) return RC_FILE_CLOSE_FAILED;
-
-  // evict all cached pages for this file
-  for (int i = 0; i < CACHE_COUNT; i++) {
-    if (readCache[i].fd == fd && readCache[i].lastAccessed != 0) {
-       readCache[i].fd = 0;
-       readCache[i].pid = 0;
-       readCache[i].lastAccessed = 0;
-    }
+  // write the dirty pages of the file to the disk. if that fails, the
+  // pages are dropped from the pool, as nothing may write them through
+  // this PageFile once it is closed, and the file is closed all the same
+  if ((rc = flush()) < 0) pool().discard(*this);
+
+  // give back the preallocated blocks beyond the end of the file.
+  // truncating the file to its own size releases them
+  struct stat statbuf;
+  if (allocEnd > epid && ::fstat(fd, &statbuf) == 0) {
+    ::ftruncate(fd, statbuf.st_size);
+  }
+
+  if (map != NULL) {
+    ::munmap(const_cast<char*>(map), offsetOf(epid));
+    map = NULL;
   }
 
+  // the dirty pages are on the disk. the file is no longer written
+  if (!readOnly) __sync_fetch_and_sub(&stats->writers, 1);
+
+  // close the file
+  if (::close(fd) < 0 && rc == 0) rc = RC_FILE_CLOSE_FAILED;
+
   // set the fd and epid to the initial state
   fd = -1; 
   epid = 0;
-  return 0;
+  return rc;
 }
 
 PageId PageFile::endPid() const 
@@ -93,86 +246,649 @@ PageId PageFile::endPid() const
   return epid;
 }
 
-RC PageFile::seek(PageId pid) const
+RC PageFile::setFormat(int format)
 {
-  return (::lseek(fd, pid * PAGE_SIZE, SEEK_SET) < 0) ? RC_FILE_SEEK_FAILED : 0;
+  RC rc;
+
+  if (fd < 0 || readOnly) return RC_FILE_WRITE_FAILED;
+  if (format == this->format) return 0;
+
+  pthread_mutex_lock(&allocLock);
+  if (base == 0) {
+    // the pages of a file without a header would move behind the new
+    // header, so only an empty file can get one
+    if (epid > 0) {
+      pthread_mutex_unlock(&allocLock);
+      return RC_INVALID_FILE_FORMAT;
+    }
+    base = pageSize;
+  }
+  this->format = format;
+  rc = writeHeader();
+  pthread_mutex_unlock(&allocLock);
+
+  return rc;
 }
 
 RC PageFile::write(PageId pid, const void* buffer)
 {
   RC rc;
   if (pid < 0) return RC_INVALID_PID; 
+  // a closed file must not leave a dirty page in the pool
+  if (fd < 0 || readOnly) return RC_FILE_WRITE_FAILED;
+
+  // write the page to the buffer pool.
+  // the pool calls writePage() when the page is written back.
+  if ((rc = pool().write(*this, pid, buffer)) < 0) return rc;
 
-  // seek to the location of the page
-  if ((rc = seek(pid) < 0)) return rc;
+  // the file grows beyond its preallocated extents
+  if (pid >= allocEnd) {
+    pthread_mutex_lock(&allocLock);
+    preallocate(pid);
+    pthread_mutex_unlock(&allocLock);
+  }
+
+  // if the written pid >= end pid, update the end pid.
+  // another thread may be extending the file at the same time.
+  PageId e;
+  while ((e = epid) <= pid && !__sync_bool_compare_and_swap(&epid, e, pid + 1));
+
+  return 0;
+}
+
+RC PageFile::allocatePage(PageId& pid)
+{
+  RC   rc = 0;
+  char buffer[MAX_PAGE_SIZE];
 
-  // write the buffer to the disk page
-  if (::write(fd, buffer, PAGE_SIZE) < 0) return RC_FILE_WRITE_FAILED;
+  if (fd <= 0 || readOnly) return RC_FILE_WRITE_FAILED;
 
-  // if the page is in read cache, invalidate it
-  for (int i = 0; i < CACHE_COUNT; i++) {
-    if (readCache[i].fd == fd && readCache[i].pid == pid &&
-        readCache[i].lastAccessed != 0) {
-       readCache[i].fd = 0;
-       readCache[i].pid = 0;
-       readCache[i].lastAccessed = 0;
-       break;
+  pthread_mutex_lock(&allocLock);
+  if (freeHead >= 0) {
+    // take the first page of the free-page list. the page stores the next
+    if ((rc = pool().read(*this, freeHead, buffer)) == 0) {
+      pid = freeHead;
+      memcpy(&freeHead, buffer, sizeof(PageId));
+      headerDirty = true;
     }
+  } else {
+    // extend the file by one page
+    pid = __sync_fetch_and_add(&epid, 1);
+    if (pid >= allocEnd) preallocate(pid);
+  }
+  pthread_mutex_unlock(&allocLock);
+
+  return rc;
+}
+
+RC PageFile::freePage(PageId pid)
+{
+  RC   rc;
+  char buffer[MAX_PAGE_SIZE];
+
+  if (fd <= 0 || readOnly) return RC_FILE_WRITE_FAILED;
+  if (pid < 0 || pid >= epid) return RC_INVALID_PID;
+
+  // the freed page links to the rest of the list
+  pthread_mutex_lock(&allocLock);
+  memset(buffer, 0, pageSize);
+  memcpy(buffer, &freeHead, sizeof(PageId));
+  if ((rc = pool().write(*this, pid, buffer)) == 0) {
+    freeHead = pid;
+    headerDirty = true;
+  }
+  pthread_mutex_unlock(&allocLock);
+
+  return rc;
+}
+
+void PageFile::preallocate(PageId pid)
+{
+  // another thread may have preallocated the extent
+  if (pid < allocEnd) return;
+
+  // compressed pages are appended to the data as they are written
+  if (compressed) {
+    allocEnd = pid + 1;
+    return;
+  }
+
+  // an extent is an eighth of the file, so that the number of extents
+  // grows slowly, but at least MIN_EXTENT pages
+  PageId count = epid / 8;
+  if (count < MIN_EXTENT) count = MIN_EXTENT;
+  if (count > MAX_EXTENT_SIZE / pageSize) count = MAX_EXTENT_SIZE / pageSize;
+
+  PageId from = allocEnd;
+  if (pid + 1 > from + count) count = pid + 1 - from;
+
+  // the size of the file is kept, so the extent does not appear as
+  // pages of the file. a file system without fallocate() allocates
+  // the blocks when the pages are written, as before
+  if (::fallocate(fd, FALLOC_FL_KEEP_SIZE, offsetOf(from), (off_t)count * pageSize) == 0) {
+    allocEnd = from + count;
+  } else {
+    allocEnd = pid + 1;
+  }
+}
+
+RC PageFile::writeHeader()
+{
+  RC    rc = 0;
+  void* page;
+
+  // the free-page list of a file without a header is not persistent
+  if (base == 0) {
+    headerDirty = false;
+    return 0;
+  }
+
+  // the whole header page is written from an aligned buffer,
+  // as direct I/O requires
+  if (::posix_memalign(&page, IO_ALIGNMENT, pageSize) != 0) return RC_FILE_WRITE_FAILED;
+  memset(page, 0, pageSize);
+  ((FileHeader*)page)->magic = FILE_MAGIC;
+  ((FileHeader*)page)->version = FILE_VERSION;
+  ((FileHeader*)page)->pageSize = pageSize;
+  ((FileHeader*)page)->freeHead = freeHead;
+  ((FileHeader*)page)->format = format;
+  if (compressed) {
+    // the directory last written by writeDirectory()
+    ((FileHeader*)page)->flags = FILE_COMPRESSED;
+    ((FileHeader*)page)->dirPages = dirCount;
+    ((FileHeader*)page)->dirOffset = dirOffset;
+  }
+  if (::pwrite(fd, page, pageSize, 0) != pageSize) rc = RC_FILE_WRITE_FAILED;
+  ::free(page);
+
+  if (rc == 0) headerDirty = false;
+  return rc;
+}
+
+void PageFile::enableDirect()
+{
+#ifdef STATX_DIOALIGN
+  struct statx stx;
+  int flags;
+
+  // the file offsets, lengths and buffers of direct I/O must be aligned
+  // as the file system requires. the buffers are aligned to
+  // IO_ALIGNMENT, and the frames of the buffer pool to the page size
+  if (::statx(fd, "", AT_EMPTY_PATH, STATX_DIOALIGN, &stx) < 0) return;
+  if (!(stx.stx_mask & STATX_DIOALIGN) || stx.stx_dio_offset_align == 0) return;
+  if (pageSize % stx.stx_dio_offset_align != 0) return;
+  if (stx.stx_dio_mem_align > (unsigned)pageSize ||
+      stx.stx_dio_mem_align > (unsigned)IO_ALIGNMENT) return;
+
+  if ((flags = ::fcntl(fd, F_GETFL)) < 0) return;
+  if (::fcntl(fd, F_SETFL, flags | O_DIRECT) < 0) return;
+  direct = true;
+#endif
+}
+
+RC PageFile::flush()
+{
+  RC rc;
+
+  if (fd <= 0) return RC_FILE_WRITE_FAILED;
+
+  if ((rc = pool().flush(*this)) < 0) return rc;
+
+  // the list and the directory are written after their pages, and the
+  // header that points to them last. the pages appended to a compressed
+  // file and its new directory go past the old directory, so the header
+  // on the disk refers to a complete directory at all times
+  pthread_mutex_lock(&allocLock);
+  if (dirDirty && (rc = writeDirectory()) == 0) headerDirty = true;
+  if (rc == 0 && headerDirty) rc = writeHeader();
+  pthread_mutex_unlock(&allocLock);
+
+  return rc;
+}
+
+RC PageFile::advise(Advice advice) const
+{
+  int madv, fadv;
+
+  if (fd <= 0) return RC_INVALID_FILE_MODE;
+
+  pthread_mutex_lock(&raLock);
+  switch (advice) {
+  case SEQUENTIAL:
+    madv = MADV_SEQUENTIAL;
+    fadv = POSIX_FADV_SEQUENTIAL;
+    if (readOnly) raWindow = MAX_READAHEAD;
+    break;
+  case RANDOM:
+    madv = MADV_RANDOM;
+    fadv = POSIX_FADV_RANDOM;
+    raWindow = 0;
+    break;
+  default:
+    madv = MADV_NORMAL;
+    fadv = POSIX_FADV_NORMAL;
+    if (readOnly) raWindow = MIN_READAHEAD;
+    break;
+  }
+  pthread_mutex_unlock(&raLock);
+
+  // the hint goes to the mapping in 'm' mode, and to the kernel's
+  // readahead of the file otherwise
+  if (map != NULL) {
+    if (::madvise(const_cast<char*>(map), offsetOf(epid), madv) < 0) {
+      return RC_INVALID_ATTRIBUTE;
+    }
+  } else if (epid > 0) {
+    if (::posix_fadvise(fd, 0, 0, fadv) != 0) return RC_INVALID_ATTRIBUTE;
+  }
+
+  return 0;
+}
+
+int PageFile::getReadaheadWindow() const
+{
+  pthread_mutex_lock(&raLock);
+  int window = raWindow;
+  pthread_mutex_unlock(&raLock);
+  return window;
+}
+
+bool PageFile::isValidPageSize(int pageSize)
+{
+  // the page size must be a power of 2
+  return (pageSize >= DEFAULT_PAGE_SIZE && pageSize <= MAX_PAGE_SIZE &&
+          (pageSize & (pageSize - 1)) == 0);
+}
+
+BufferPool& PageFile::pool() const
+{
+  return BufferPool::getPool(pageSize);
+}
+
+RC PageFile::writePage(PageId pid, const void* buffer) const
+{
+  if (compressed) {
+    const char* buffers[1] = { (const char*) buffer };
+    return writeCompressed(pid, 1, buffers);
+  }
+
+  long long begin = IOStats::now();
+
+  // write the buffer to the disk page.
+  // pwrite() does not move the shared file offset, so concurrent
+  // writes of different pages do not interfere with each other.
+  if (::pwrite(fd, buffer, pageSize, offsetOf(pid)) != pageSize) {
+    return RC_FILE_WRITE_FAILED;
+  }
+
+  IOStats::write(stats, 1, pageSize, IOStats::now() - begin);
+
+  return 0;
+}
+
+RC PageFile::writePages(PageId pid, int count, const char* const* buffers) const
+{
+  struct iovec iov[MAX_IO_PAGES];
+
+  if (count <= 0 || count > MAX_IO_PAGES) return RC_INVALID_PID;
+  if (compressed) return writeCompressed(pid, count, buffers);
+
+  for (int i = 0; i < count; i++) {
+    iov[i].iov_base = const_cast<char*>(buffers[i]);
+    iov[i].iov_len = pageSize;
   }
 
-  // if the written pid >= end pid, update the end pid
-  if (pid >= epid) epid = pid + 1;
+  // write the run of pages with a single system call
+  long long begin = IOStats::now();
+  if (::pwritev(fd, iov, count, offsetOf(pid)) != (ssize_t)count * pageSize) {
+    return RC_FILE_WRITE_FAILED;
+  }
 
-  // increase page write count
-  writeCount++;
+  IOStats::write(stats, count, (long)count * pageSize, IOStats::now() - begin);
 
   return 0;
 }
 
 RC PageFile::read(PageId pid, void* buffer) const
 {
-  RC rc;
+  if (pid < 0 || pid >= epid) return RC_INVALID_PID; 
+
+  readahead(pid);
+
+  if (map != NULL) {
+    memcpy(buffer, map + offsetOf(pid), pageSize);
+    IOStats::mapped(stats);
+    return 0;
+  }
+
+  // read the page through the buffer pool.
+  // the pool calls readPage() if the page is not cached.
+  return pool().read(*this, pid, buffer);
+}
+
+RC PageFile::read(PageId pid, PageHandle& page) const
+{
+  page.release();
 
   if (pid < 0 || pid >= epid) return RC_INVALID_PID; 
 
-  //
-  // if the page is in cache, read it from there
-  //
-  for (int i = 0; i < CACHE_COUNT; i++) {
-    if (readCache[i].fd == fd && readCache[i].pid == pid && 
-        readCache[i].lastAccessed != 0) {
-       memcpy(buffer, readCache[i].buffer, PAGE_SIZE);
-       readCache[i].lastAccessed = ++cacheClock;
-       return 0;
+  readahead(pid);
+
+  // a mapped page needs no pin. it stays valid until the file is closed
+  if (map != NULL) {
+    page.ptr = map + offsetOf(pid);
+    IOStats::mapped(stats);
+    return 0;
+  }
+
+  page.pool = &pool();
+  return page.pool->pin(*this, pid, page.ptr, page.frame);
+}
+
+RC PageFile::readPage(PageId pid, void* buffer) const
+{
+  if (compressed) {
+    char* buffers[1] = { (char*) buffer };
+    return readCompressed(pid, 1, buffers);
+  }
+
+  long long begin = IOStats::now();
+
+  // read the page from the disk without moving the shared file offset
+  if (::pread(fd, buffer, pageSize, offsetOf(pid)) != pageSize) {
+    return RC_FILE_READ_FAILED;
+  }
+
+  IOStats::read(stats, 1, pageSize, IOStats::now() - begin);
+
+  return 0;
+}
+
+RC PageFile::readPages(PageId pid, int count, char* const* buffers) const
+{
+  struct iovec iov[MAX_IO_PAGES];
+
+  if (count <= 0 || count > MAX_IO_PAGES) return RC_INVALID_PID;
+  if (compressed) return readCompressed(pid, count, buffers);
+
+  for (int i = 0; i < count; i++) {
+    iov[i].iov_base = buffers[i];
+    iov[i].iov_len = pageSize;
+  }
+
+  // read the run of pages with a single system call
+  long long begin = IOStats::now();
+  if (::preadv(fd, iov, count, offsetOf(pid)) != (ssize_t)count * pageSize) {
+    return RC_FILE_READ_FAILED;
+  }
+
+  IOStats::read(stats, count, (long)count * pageSize, IOStats::now() - begin);
+
+  return 0;
+}
+
+//
+// compressed pages
+//
+// a compressed page is stored at any byte offset after the header, and
+// the page directory records its location, its compressed length and
+// the space reserved for it. a page that does not compress is stored
+// as it is, with the length of a page. a page that no longer fits its
+// space when it is written again moves to the end of the data.
+// the directory is written after the data when the file is flushed.
+//
+
+RC PageFile::readCompressed(PageId pid, int count, char* const* buffers) const
+{
+  PageLocation loc[MAX_IO_PAGES];
+  RC   rc = 0;
+
+  pthread_mutex_lock(&allocLock);
+  for (int i = 0; i < count; i++) {
+    if (pid + i < (PageId) dir.size()) loc[i] = dir[pid + i];
+    else loc[i].length = 0;
+  }
+  pthread_mutex_unlock(&allocLock);
+
+  // a page that was allocated but never written is not in the file
+  for (int i = 0; i < count; i++) {
+    if (loc[i].length <= 0) return RC_FILE_READ_FAILED;
+  }
+
+  // pages written in sequence lie back to back, so they are usually
+  // read with a single system call
+  for (int i = 0, next; i < count && rc == 0; i = next) {
+    long long length = loc[i].length;
+    for (next = i + 1; next < count &&
+                       loc[next].offset == loc[next - 1].offset + loc[next - 1].length; next++) {
+      length += loc[next].length;
+    }
+
+    char* data = new char[length];
+    long long begin = IOStats::now();
+    if (::pread(fd, data, length, loc[i].offset) != length) {
+      rc = RC_FILE_READ_FAILED;
+    } else {
+      IOStats::read(stats, next - i, length, IOStats::now() - begin);
+      const char* p = data;
+      for (int j = i; j < next && rc == 0; p += loc[j].length, j++) {
+        if (loc[j].length == pageSize) memcpy(buffers[j], p, pageSize);
+        else rc = PageCodec::decompress(p, loc[j].length, buffers[j], pageSize);
+      }
     }
+    delete [] data;
   }
 
-  // seek to the page
-  if ((rc = seek(pid) < 0)) return rc;
-  
-  // find the cache slot to evict
-  int toEvict = 0; 
-  for (int i = 0; i < CACHE_COUNT; i++) {
-    if (readCache[i].lastAccessed == 0) {
-      toEvict = i;
-      break;
+  return rc;
+}
+
+RC PageFile::writeCompressed(PageId pid, int count, const char* const* buffers) const
+{
+  PageLocation loc[MAX_IO_PAGES];
+  RC   rc = 0;
+
+  // compress the pages back to back
+  char* data = new char[(long) count * pageSize];
+  char* p = data;
+  for (int i = 0; i < count; i++) {
+    loc[i].length = PageCodec::compress(buffers[i], pageSize, p, pageSize - 1);
+    if (loc[i].length == 0) {
+      memcpy(p, buffers[i], pageSize);
+      loc[i].length = pageSize;
     }
-    if (readCache[i].lastAccessed < readCache[toEvict].lastAccessed) {
-      toEvict = i;
+    p += loc[i].length;
+  }
+
+  // overwrite the pages that still fit their space,
+  // and append the others to the end of the data
+  pthread_mutex_lock(&allocLock);
+  if ((PageId) dir.size() < pid + count) {
+    PageLocation none = { 0, 0, 0 };
+    dir.resize(pid + count, none);
+  }
+  for (int i = 0; i < count; i++) {
+    PageLocation& d = dir[pid + i];
+    if (d.length > 0 && loc[i].length <= d.capacity) {
+      loc[i].offset = d.offset;
+      loc[i].capacity = d.capacity;
+    } else {
+      loc[i].offset = dataEnd;
+      loc[i].capacity = loc[i].length;
+      dataEnd += loc[i].length;
     }
+    d = loc[i];
   }
-  readCache[toEvict].fd = fd;
-  readCache[toEvict].pid = pid;
-  readCache[toEvict].lastAccessed = ++cacheClock;
- 
-  // read the page to cache first and copy it to the buffer
-  if (::read(fd, readCache[toEvict].buffer, PAGE_SIZE) < 0) {
-    return RC_FILE_READ_FAILED;
+  dirDirty = true;
+  pthread_mutex_unlock(&allocLock);
+
+  // write the runs of pages that are back to back in the file together
+  p = data;
+  for (int i = 0, next; i < count && rc == 0; i = next) {
+    long long length = loc[i].length;
+    for (next = i + 1; next < count &&
+                       loc[next].offset == loc[next - 1].offset + loc[next - 1].length; next++) {
+      length += loc[next].length;
+    }
+
+    long long begin = IOStats::now();
+    if (::pwrite(fd, p, length, loc[i].offset) != length) {
+      rc = RC_FILE_WRITE_FAILED;
+    } else {
+      IOStats::write(stats, next - i, length, IOStats::now() - begin);
+    }
+    p += length;
   }
-  memcpy(buffer, readCache[toEvict].buffer, PAGE_SIZE);
 
-  // increase the page read count
-  readCount++;
+  delete [] data;
+  return rc;
+}
+
+RC PageFile::readDirectory(long long offset, int count)
+{
+  PageLocation none = { 0, 0, 0 };
+
+  dir.assign(count, none);
+  epid = count;
+  dirOffset = offset;
+  dirCount = count;
+  // new pages go past the directory, which stays valid until the header
+  // points to the next one
+  dataEnd = offset + (long long) count * sizeof(PageLocation);
+
+  long long length = (long long) count * sizeof(PageLocation);
+  if (count > 0 && ::pread(fd, &dir[0], length, offset) != length) {
+    return RC_INVALID_FILE_FORMAT;
+  }
 
   return 0;
 }
+
+RC PageFile::writeDirectory()
+{
+  PageLocation none = { 0, 0, 0 };
+
+  // the directory has an entry for every page, including the pages
+  // allocated but not written yet. it is written after the data, without
+  // overwriting the old directory that the header on the disk points to.
+  // the space of the old directory is not reused
+  dir.resize(epid, none);
+  long long length = (long long) epid * sizeof(PageLocation);
+  if (epid > 0 && ::pwrite(fd, &dir[0], length, dataEnd) != length) {
+    return RC_FILE_WRITE_FAILED;
+  }
+
+  // the pages and the directory must be on the disk before the header
+  // is switched to the new directory
+  if (::fdatasync(fd) < 0) return RC_FILE_WRITE_FAILED;
+
+  dirOffset = dataEnd;
+  dirCount = epid;
+  dataEnd += length;
+  dirDirty = false;
+  return 0;
+}
+
+RC PageFile::prefetch(const PageId* pids, int count) const
+{
+  RC rc;
+
+  if (fd <= 0) return RC_FILE_READ_FAILED;
+
+  // as with readahead, a prefetched page of a writable file could
+  // overwrite a newer version written back in the meantime
+  if (readOnly && map == NULL) {
+    if ((rc = pool().prefetch(*this, pids, count)) < 0) return rc;
+    IOStats::prefetch(stats, rc);
+    return 0;
+  }
+
+  if (map != NULL) {
+    long mask = ::sysconf(_SC_PAGESIZE) - 1;
+    for (int i = 0; i < count; i++) {
+      if (pids[i] < 0 || pids[i] >= epid) continue;
+      size_t begin = offsetOf(pids[i]) & ~mask;
+      size_t end = offsetOf(pids[i] + 1);
+      ::madvise(const_cast<char*>(map) + begin, end - begin, MADV_WILLNEED);
+      IOStats::prefetch(stats, 1);
+    }
+  }
+
+  return 0;
+}
+
+void PageFile::readahead(PageId pid) const
+{
+  PageId from;
+  int    count;
+
+  // the state is updated under raLock, and the pages are read after
+  // the lock is released
+  pthread_mutex_lock(&raLock);
+
+  // several reads of the same page, e.g., for the records in the page,
+  // say nothing about the access pattern
+  if (raWindow == 0 || pid == raLast) {
+    pthread_mutex_unlock(&raLock);
+    return;
+  }
+
+  if (pid != raLast + 1) {
+    // a random read. start over with the smallest window
+    raLast = pid;
+    raNext = pid + 1;
+    raWindow = MIN_READAHEAD;
+    pthread_mutex_unlock(&raLock);
+    return;
+  }
+  raLast = pid;
+
+  // prefetch the next window when the reader enters the second half of
+  // the current one, so that the pages are ready before they are needed.
+  // if pid itself has not been prefetched, it is read with the window.
+  if (pid + raWindow / 2 < raNext) {
+    pthread_mutex_unlock(&raLock);
+    return;
+  }
+
+  from = (raNext > pid) ? raNext : pid;
+  count = (raWindow < epid - from) ? raWindow : epid - from;
+  raNext = from + count;
+  if (raWindow < MAX_READAHEAD) raWindow *= 2;
+  pthread_mutex_unlock(&raLock);
+  if (count <= 0) return;
+
+  if (map != NULL) {
+    // ask the kernel to read the pages of the mapping in the background.
+    // madvise() needs an address aligned to the memory page size
+    long   mask = ::sysconf(_SC_PAGESIZE) - 1;
+    size_t begin = offsetOf(from) & ~mask;
+    size_t end = offsetOf(from + count);
+    ::madvise(const_cast<char*>(map) + begin, end - begin, MADV_WILLNEED);
+    IOStats::prefetch(stats, count);
+  } else {
+    // read the pages that are not in the buffer pool with one vectored read
+    RC rc = pool().prefetch(*this, from, count);
+    if (rc > 0) IOStats::prefetch(stats, rc);
+  }
+}
+
+PageHandle::PageHandle()
+{
+  ptr = NULL;
+  frame = NULL;
+  pool = NULL;
+}
+
+PageHandle::~PageHandle()
+{
+  release();
+}
+
+void PageHandle::release()
+{
+  // pages of a mapped file are not pinned in the buffer pool
+  if (frame != NULL) pool->unpin(frame);
+  ptr = NULL;
+  frame = NULL;
+  pool = NULL;
+}
@@ -11,29 +11,120 @@
 #define PAGEFILE_H
 
 #include <string>
+#include <vector>
+#include <pthread.h>
+#include <sys/types.h>
 #include "Bruinbase.h"
+#include "IOStats.h"
 
 typedef int PageId;
 
+class BufferPool;
+
+/**
+ * a read-only reference to a page pinned in the buffer pool.
+ * the page stays in the pool while the handle holds it, and it is
+ * unpinned when the handle is released or destructed.
+ * a PageHandle is filled in by PageFile::read(pid, handle).
+ */
+class PageHandle {
+ public:
+  PageHandle();
+  ~PageHandle();
+
+  /**
+   * @return pointer to the content of the pinned page.
+   * NULL if the handle does not hold a page.
+   */
+  const char* data() const { return ptr; }
+
+  /**
+   * unpin the page held by the handle, if any.
+   */
+  void release();
+
+ private:
+  friend class PageFile;
+
+  // a handle cannot be copied because it owns a pin
+  PageHandle(const PageHandle&);
+  PageHandle& operator=(const PageHandle&);
+
+  const char* ptr;    // the page content inside the buffer pool frame
+  void*       frame;  // the pinned buffer pool frame
+  BufferPool* pool;   // the buffer pool of the frame
+};
+
 /**
- * read/write a file in the unit of a page
+ * read/write a file in the unit of a page.
+ * all disk I/O is positional (pread/pwrite), so a PageFile can be
+ * shared by several threads once it is opened.
+ *
+ * the page size is chosen per file when the file is created.
+ * a file with the default 1KB pages has no header, as all files created
+ * before the page size became configurable. a file with any other page
+ * size starts with a header page that records the size, and its page
+ * pid is stored right after the header.
+ *
+ * a growing file is extended by extents preallocated with fallocate(),
+ * so appending pages does not allocate disk blocks one page at a time.
+ * pages given back with freePage() are kept in a free-page list, and
+ * allocatePage() reuses them before extending the file. the list is
+ * chained through the free pages, and its head is stored in the header.
+ * a file without a header keeps its list only while it is open.
+ *
+ * with direct I/O turned on by setDirectIO(), files are read and written
+ * with O_DIRECT, so their pages are cached only in the buffer pool and
+ * not a second time in the OS page cache. all buffers of direct I/O are
+ * aligned to IO_ALIGNMENT bytes. a file whose page size does not meet
+ * the alignment required by its file system stays in buffered mode.
+ *
+ * the pages of a file can be compressed, as chosen when the file is
+ * created. a compressed file always has a header, and a page directory
+ * that maps each page to its compressed bytes in the file. the buffer
+ * pool still caches whole pages, so compression saves disk space and
+ * I/O, while the pool capacity counts in pages as before.
+ *
+ * the header also records the format of the pages, a number chosen by
+ * the user of the file, e.g., the record layout of a RecordFile. a file
+ * without a header has format 0.
  */
 class PageFile {
  public:
 
-  static const int PAGE_SIZE = 1024;    // the size of a page is 1KB
+  static const int DEFAULT_PAGE_SIZE = 1024; // the page size of files without a header
+  static const int MAX_PAGE_SIZE = 65536;    // the largest page size
+  static const int MAX_IO_PAGES = 64;   // max # pages in a vectored I/O
+  static const int MIN_READAHEAD = 4;   // the initial readahead window
+  static const int MAX_READAHEAD = MAX_IO_PAGES; // the largest readahead window
+  static const int IO_ALIGNMENT = 4096; // the alignment of the buffers of direct I/O
+  static const int MIN_EXTENT = 64;     // the smallest extent preallocated in pages
+  static const int MAX_EXTENT_SIZE = 16 * 1024 * 1024; // the largest extent in bytes
+
+  // hints on how the pages of a file will be accessed. see advise()
+  enum Advice { NORMAL, SEQUENTIAL, RANDOM };
 
   PageFile();
   PageFile(const std::string& filename, char mode);
+  ~PageFile();
 
   /**
    * open a file in read or write mode.
    * when opened in 'w' mode, if the file does not exist, it is created.
+   * when opened in 'm' mode, the file is read-only and memory-mapped as
+   * a whole. its pages are read from the mapping instead of the buffer pool.
+   * the page size and the compression of an existing file are read from
+   * its header, and pageSize and compress are used only when the file
+   * is created. a compressed file is not mapped in 'm' mode.
    * @param filename[IN] the name of the file to open
-   * @param mode[IN] 'r' for read, 'w' for write
+   * @param mode[IN] 'r' for read, 'w' for write, 'm' for mapped read
+   * @param pageSize[IN] the page size of a new file. a power of 2 between
+   *                     DEFAULT_PAGE_SIZE and MAX_PAGE_SIZE, or 0 for
+   *                     DEFAULT_PAGE_SIZE
+   * @param compress[IN] true to compress the pages of a new file
    * @return error code. 0 if no error
    */
-  RC open(const std::string& filename, char mode);
+  RC open(const std::string& filename, char mode, int pageSize = 0, bool compress = false);
 
   /**
    * close the file.
@@ -48,17 +139,77 @@ class PageFile {
    * @return error code. 0 if no error
    */
   RC read(PageId pid, void *buffer) const;
+
+  /**
+   * pin a disk page in the buffer pool and access it in place.
+   * unlike read(pid, buffer), the page is not copied.
+   * any page previously held by the handle is released first.
+   * @param pid[IN] the page to read
+   * @param page[OUT] the handle to the pinned page
+   * @return error code. 0 if no error
+   */
+  RC read(PageId pid, PageHandle& page) const;
   
+  /**
+   * read a batch of pages into the buffer pool ahead of use.
+   * the pages are read in parallel, so the latencies of the disk
+   * reads overlap. in 'm' mode, the kernel is asked to read the pages
+   * of the mapping in the background instead. pages that are already
+   * cached or out of the file are skipped.
+   * @param pids[IN] the pages to read
+   * @param count[IN] # pages in pids
+   * @return error code. 0 if no error
+   */
+  RC prefetch(const PageId* pids, int count) const;
+
   /**
    * write the memory buffer to the disk page.
    * if (pid >= endPid()), the file is expanded such that
    * endPid() becomes (pid + 1).
+   * the page is kept dirty in the buffer pool and reaches the disk
+   * when it is evicted, or when the file is flushed or closed.
    * @param pid[IN] page to write to
    * @param buffer[IN] the content to write
    * @return error code. 0 if no error
    */
   RC write(PageId pid, const void *buffer);
+
+  /**
+   * allocate a page to write to, separately from writing it.
+   * a page in the free-page list is reused if there is one. otherwise
+   * the file is extended by one page, and endPid() grows by one.
+   * the content of the page is undefined until it is written.
+   * @param pid[OUT] the allocated page
+   * @return error code. 0 if no error
+   */
+  RC allocatePage(PageId& pid);
+
+  /**
+   * give a page back to the file. the page is added to the free-page
+   * list and returned by a later allocatePage(). its content is lost.
+   * nothing calls this yet, as neither the tables nor the indexes ever
+   * delete a page, so the free-page list of a file is always empty.
+   * @param pid[IN] the page to free
+   * @return error code. 0 if no error
+   */
+  RC freePage(PageId pid);
+
+  /**
+   * write all dirty pages of the file in the buffer pool to the disk.
+   * @return error code. 0 if no error
+   */
+  RC flush();
     
+  /**
+   * tell the kernel how the pages of the file are going to be accessed.
+   * the hint is given with madvise() in 'm' mode and with
+   * posix_fadvise() otherwise. it also sets the readahead of the file:
+   * RANDOM turns it off, and SEQUENTIAL starts with the largest window.
+   * @param advice[IN] the expected access pattern
+   * @return error code. 0 if no error
+   */
+  RC advise(Advice advice) const;
+
   /**
    * note the +1 part. The last page id in the file is actually endPid()-1.
    * that is, the last page can be read by "read(endPid()-1, buffer)".
@@ -67,46 +218,208 @@ class PageFile {
   PageId endPid() const;
 
   /**
-   * @return the total # of disk reads
+   * @return the size of the pages of the file in bytes
+   */
+  int getPageSize() const { return pageSize; }
+
+  /**
+   * @return the device and the inode number of the file. together they
+   * identify the file while it exists, whatever name it is opened with
+   */
+  dev_t getDevice() const { return dev; }
+  ino_t getInode() const { return ino; }
+
+  /**
+   * @param pageSize[IN] a page size in bytes
+   * @return true if a file can be created with the page size
+   */
+  static bool isValidPageSize(int pageSize);
+
+  /**
+   * @return the format of the pages of the file, as set by setFormat()
    */
-  static int getPageReadCount()  { return readCount; }
+  int getFormat() const { return format; }
+
+  /**
+   * record the format of the pages in the header of the file.
+   * a file without a header gets one, which is only possible while
+   * the file is empty.
+   * @param format[IN] the format of the pages. 0 is the default format
+   * @return error code. 0 if no error
+   */
+  RC setFormat(int format);
+
+  /**
+   * @return true if the pages of the file are compressed
+   */
+  bool isCompressed() const { return compressed; }
+
+  /**
+   * @return true if the file is read and written with direct I/O
+   */
+  bool isDirect() const { return direct; }
+
+  /**
+   * turn direct I/O on or off for the files opened afterwards.
+   * files opened in 'm' mode always go through the OS page cache.
+   * @param on[IN] true to open the files with O_DIRECT
+   */
+  static void setDirectIO(bool on) { directIO = on; }
+
+  /**
+   * @return the current readahead window of the file in pages.
+   * 0 if readahead is turned off
+   */
+  int getReadaheadWindow() const;
+
+  /**
+   * @return the I/O counters of the file. NULL if the file is not open
+   */
+  const IOCounters* getStats() const { return stats ? &stats->c : NULL; }
+
+  /**
+   * count pages of the file that a scan skipped without reading them,
+   * e.g., because the zone map of a RecordFile ruled them out.
+   * @param pages[IN] # pages skipped
+   * @param blocks[IN] # blocks of the pages skipped by a value filter
+   */
+  void countSkipped(int pages, int blocks = 0) const { IOStats::skip(stats, pages, blocks); }
+
+  /**
+   * @return the total # of pages read from the disk by all files
+   */
+  static long long getPageReadCount()  { return IOStats::total().pagesRead; }
   
   /**
-   * @return the total # of disk writes
+   * @return the total # of disk writes, i.e., dirty page write-backs
+   */
+  static long long getPageWriteCount() { return IOStats::total().pagesWritten; }
+
+  /**
+   * @return the total # of pages prefetched by readahead
    */
-  static int getPageWriteCount() { return writeCount; }
+  static long long getPrefetchCount() { return IOStats::total().prefetched; }
 
  protected:
   /**
-   * move the file cursor to the beginning of a page.
-   * this is an internal function not exposed to public.
-   * @param pid[IN] page to seek to
+   * read a disk page directly from the file, bypassing the buffer pool.
+   * this is an internal function used by BufferPool on a cache miss.
+   * @param pid[IN] the page to read
+   * @param buffer[OUT] pointer to memory buffer
+   * @return error code. 0 if no error
+   */
+  RC readPage(PageId pid, void *buffer) const;
+
+  /**
+   * read a run of consecutive disk pages with one vectored read.
+   * @param pid[IN] the first page to read
+   * @param count[IN] # pages to read. at most MAX_IO_PAGES
+   * @param buffers[OUT] the memory buffers for the pages
+   * @return error code. 0 if no error
+   */
+  RC readPages(PageId pid, int count, char* const* buffers) const;
+
+  /**
+   * write a disk page directly to the file, bypassing the buffer pool.
+   * this is an internal function used by BufferPool to write back
+   * a dirty page.
+   * @param pid[IN] the page to write to
+   * @param buffer[IN] the content to write
    * @return error code. 0 if no error
    */
-  RC seek(PageId pid) const;
+  RC writePage(PageId pid, const void *buffer) const;
+
+  /**
+   * write a run of consecutive disk pages with one vectored write.
+   * @param pid[IN] the first page to write to
+   * @param count[IN] # pages to write. at most MAX_IO_PAGES
+   * @param buffers[IN] the contents of the pages
+   * @return error code. 0 if no error
+   */
+  RC writePages(PageId pid, int count, const char* const* buffers) const;
 
  private:
+  friend class BufferPool;
+  friend class AsyncIO;
+
+  // detect sequential reads and prefetch the pages that follow pid
+  void readahead(PageId pid) const;
+
+  // the location of the page pid in the file
+  off_t offsetOf(PageId pid) const { return base + (off_t)pid * pageSize; }
+
+  // true if the file is open for writing, or has been opened for writing
+  // since this PageFile was opened. the pages read from it may be stale
+  bool changedSinceOpen() const {
+    return stats->writers > 0 || stats->generation != generation;
+  }
+
+  // the buffer pool for the pages of the file
+  BufferPool& pool() const;
+
+  // preallocate the extent that contains page pid. called with allocLock
+  void preallocate(PageId pid);
+
+  // write the free-page list head to the header
+  RC writeHeader();
+
+  // switch the open file to direct I/O if its file system allows it
+  void enableDirect();
+
+  // the location of a compressed page in the file
+  struct PageLocation {
+    long long offset;   // the first byte of the page
+    int  length;        // # bytes of the compressed page. 0 if not written
+    int  capacity;      // # bytes reserved for the page
+  };
+
+  // readPages() and writePages() for compressed files
+  RC readCompressed(PageId pid, int count, char* const* buffers) const;
+  RC writeCompressed(PageId pid, int count, const char* const* buffers) const;
+
+  // read and write the page directory of a compressed file.
+  // writeDirectory() is called with allocLock
+  RC readDirectory(long long offset, int count);
+  RC writeDirectory();
+
   int     fd;     // file descriptor of the associated unix file
   PageId  epid;   // (last page id + 1) of the file
+  dev_t   dev;    // device and inode of the file. the buffer pool
+  ino_t   ino;    //   identifies the cached pages of the file by these
+  int     pageSize; // the size of the pages of the file
+  off_t   base;   // the size of the file header. 0 if there is none
+  bool    readOnly; // true if the file was opened in 'r' or 'm' mode
+  bool    direct;   // true if the file was opened with O_DIRECT
+  bool    compressed; // true if the pages of the file are compressed
+  int     format;   // the format of the pages. see setFormat()
+  const char* map;  // the mapping of the whole file in 'm' mode. NULL otherwise
+
+  // readahead state. raLock protects the fields below it. it is held
+  // only while the state is updated, never during the I/O
+  mutable pthread_mutex_t raLock;
+  mutable PageId raLast;   // the last page read
+  mutable PageId raNext;   // the first page after the prefetched ones
+  mutable int    raWindow; // # pages to prefetch next. 0 if turned off
 
-  //
-  // the following set of members implement LRU caching 
-  //
-  static const int CACHE_COUNT = 10;
+  // page allocation. allocLock protects the fields below it
+  mutable pthread_mutex_t allocLock;
+  PageId  allocEnd;  // the end of the extents preallocated on the disk
+  PageId  freeHead;  // the first page of the free-page list. -1 if empty
+  bool    headerDirty; // true if freeHead is not in the header yet
 
-  static int cacheClock; // clock tick counter for LRU policy
+  // the page directory of a compressed file
+  mutable std::vector<PageLocation> dir;
+  mutable long long dataEnd;  // the end of the compressed pages and directories
+  long long dirOffset;        // the location of the directory on the disk
+  int     dirCount;           // # entries of the directory on the disk
+  mutable bool dirDirty;      // true if dir is not on the disk yet
 
-  // the actual cache data structure
-  static struct cacheStruct {
-    int    fd;              // file id of the cached page
-    PageId pid;             // page id of the cached page
-    int    lastAccessed;    // the last time the cached page was accessed
-                            //   (lastAccessed == 0) means that the buffer is empty
-    char buffer[PAGE_SIZE]; // the buffer used for caching
-  } readCache[CACHE_COUNT];
+  // the I/O counters of the file. they are shared by all PageFiles
+  // that open the same file, and outlive them
+  IOStats::FileStats* stats;
+  unsigned generation;   // stats->generation when the file was opened
 
-  static int readCount;  // total # of page reads 
-  static int writeCount; // total # of page writes 
+  static bool directIO;  // true if new files are opened with O_DIRECT
 };
   
 #endif // PAGEFILE_H
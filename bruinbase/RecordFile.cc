@@ -7,6 +7,9 @@
  * @date 3/24/2008
  */
 
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
 #include "Bruinbase.h"
 #include "RecordFile.h"
 
@@ -31,6 +34,101 @@ static int getRecordCount(const char* page);
 // update # records stored in the page
 static void setRecordCount(char* page, int count);
 
+//
+// a page of a SLOTTED file starts with a SlottedHeader, followed by
+// the slot directory. the records are stored from the end of the page
+// backwards, and a record is its key followed by the bytes of its value.
+//
+// a page of a PAX file is a SLOTTED page whose keys are taken out of the
+// records: the header is followed by the array of the keys, then the
+// slot directory. the records are only the bytes of their values
+//
+struct SlottedHeader {
+  int count;      // # records in the page, as in a FIXED page
+  int dataStart;  // the first byte of the records
+};
+
+struct Slot {
+  unsigned short offset;  // the first byte of the record
+  unsigned short length;  // # bytes of the value
+};
+
+// initialize an empty page of a SLOTTED or PAX file
+static void initSlottedPage(char* page, int pageSize);
+
+// # bytes the record takes in a page of a SLOTTED or PAX file
+static int slottedSize(const std::string& value);
+
+// # free bytes in a page of a SLOTTED or PAX file
+static int slottedFree(const char* page, RecordFile::Format format);
+
+// write the record to a page of a SLOTTED or PAX file as its n'th record.
+// the page must have slottedSize(value) bytes free
+static void writeSlotted(char* page, RecordFile::Format format, int n,
+                         int key, const std::string& value);
+
+
+// find the key and the value of the n'th record in a page of a FIXED,
+// SLOTTED or PAX file
+static void viewRecord(const char* page, RecordFile::Format format, int n,
+                       int& key, const char*& value, int& length);
+
+//
+// a page of a DICTIONARY file has # records in its first four bytes, as
+// a FIXED page, followed by the array of the keys and the array of the
+// codes of the values. each array has room for recordsPerPage records
+//
+
+// the key array and the code array of a page of a DICTIONARY file
+static int* codedKeys(char* page) { return (int*)(page + sizeof(int)); }
+static int* codedValues(char* page, int capacity) { return codedKeys(page) + capacity; }
+
+//
+// a dictionary file starts with a DictHeader, followed by the values
+// of the codes 0, 1, ..., each as its length and its bytes
+//
+struct DictHeader {
+  int magic;      // DICT_MAGIC
+  int version;    // DICT_VERSION
+  int count;      // # values in the dictionary
+  long long dev;  // the device and inode of the RecordFile. the dictionary
+  long long ino;  //   belongs to no other file. version 2 and later
+};
+
+static const int DICT_MAGIC = 0x42424443;  // "BBDC"
+static const int DICT_VERSION = 2;
+
+// the size of the header of version 1, without dev and ino
+static const size_t DICT_HEADER_V1 = 3 * sizeof(int);
+
+//
+// a zone map file starts with a ZoneHeader, followed by the KeyRange
+// of each page of the RecordFile, and then the value filter of each
+// block of FILTER_BLOCK_PAGES pages
+//
+struct ZoneHeader {
+  int magic;      // ZONE_MAGIC
+  int version;    // ZONE_VERSION
+  RecordId end;   // the end record id of the RecordFile. the zone map is
+                  //   up to date only if the RecordFile ends there
+  int count;      // # pages in the zone map
+  int filterBytes;// # bytes in the value filter of a block
+  int records;    // # records in the RecordFile
+  int minKey;     // the smallest key in the RecordFile. INT_MAX if none
+  int maxKey;     // the largest key in the RecordFile. INT_MIN if none
+  long long dev;  // the device and inode of the RecordFile. a zone map of
+  long long ino;  //   another file with the same end is not used
+};
+
+static const int ZONE_MAGIC = 0x42425a4d;  // "BBZM"
+static const int ZONE_VERSION = 4;
+
+// # bits set for a value in a value filter
+static const int FILTER_HASHES = 3;
+
+// the bits of a value in a value filter of the given # bits
+static void filterBits(const char* value, int length, int bits, int* pos);
+
 
 //
 // helper functions for RecordId manipulation
@@ -57,7 +155,7 @@ RecordId& operator++ (RecordId& rid)
   if (++rid.sid >= RecordFile::RECORDS_PER_PAGE) {
     rid.pid++;
     rid.sid = 0;
-  } 
+  }
 
   return rid;
 }
@@ -106,20 +204,61 @@ RecordFile::RecordFile()
 {
   erid.pid = 0;
   erid.sid = 0;
+  recordsPerPage = 0;
+  format = FIXED;
+  zonesValid = zonesDirty = false;
+  dictDirty = false;
 }
 
 RecordFile::RecordFile(const string& filename, char mode)
 {
+  zonesValid = zonesDirty = false;
+  dictDirty = false;
   open(filename, mode);
 }
 
-RC RecordFile::open(const string& filename, char mode)
+RC RecordFile::open(const string& filename, char mode, int pageSize,
+                    bool compress, Format format)
 {
   RC   rc;
-  char page[PageFile::PAGE_SIZE];
+  PageHandle page;
 
   // open the page file
-  if ((rc = pf.open(filename, mode)) < 0) return rc;
+  if ((rc = pf.open(filename, mode, pageSize, compress)) < 0) return rc;
+
+  // a new file takes the given format, which is kept in the header of
+  // the page file. FIXED is format 0, so older files are FIXED
+  if (pf.endPid() == 0 && (mode == 'w' || mode == 'W') && pf.getFormat() != format) {
+    if ((rc = pf.setFormat(format)) < 0) {
+      pf.close();
+      return rc;
+    }
+  }
+  if (pf.getFormat() != FIXED && pf.getFormat() != SLOTTED &&
+      pf.getFormat() != PAX && pf.getFormat() != DICTIONARY) {
+    pf.close();
+    return RC_INVALID_FILE_FORMAT;
+  }
+  this->format = (Format) pf.getFormat();
+
+  // the dictionary and the zone map of a new table may be left over from
+  // a deleted table of the same name. they are removed, so that the new
+  // table starts with its own
+  dictFile = filename + ".dict";
+  zoneFile = filename + ".zone";
+  if (pf.endPid() == 0 && (mode == 'w' || mode == 'W')) {
+    ::unlink(dictFile.c_str());
+    ::unlink(zoneFile.c_str());
+  }
+
+  // the slots that fit in a page of the file
+  if (isSlotted()) {
+    recordsPerPage = (pf.getPageSize() - sizeof(SlottedHeader)) / (sizeof(Slot) + sizeof(int));
+  } else if (this->format == DICTIONARY) {
+    recordsPerPage = (pf.getPageSize() - sizeof(int)) / (2 * sizeof(int));
+  } else {
+    recordsPerPage = (pf.getPageSize() - sizeof(int)) / SLOT_SIZE;
+  }
   
   //
   // in the rest of this function, we set the end record id
@@ -132,25 +271,44 @@ RC RecordFile::open(const string& filename, char mode)
   // set the end record id to (0, 0).
   if (erid.pid == 0) {
     erid.sid = 0;
-    return 0;
+  } else {
+    // obtain # records in the last page to set sid of the end record id.
+    // read the last page of the file and get # records in the page.
+    // remeber that the id of the last page is endPid()-1 not endPid().
+    if ((rc = pf.read(--erid.pid, page)) < 0) {
+      // an error occurred during page read
+      erid.pid = erid.sid = 0;
+      pf.close();
+      return rc;
+    }
+
+    // get # records in the last page. a SLOTTED or PAX page is full only
+    // when the next record does not fit, which append() finds out
+    erid.sid = getRecordCount(page.data());
+    page.release();
+    if (!isSlotted() && erid.sid >= recordsPerPage) {
+      // the last page is full. advance the end record id to the next page.
+      erid.pid++;
+      erid.sid = 0;
+    }
   }
 
-  // obtain # records in the last page to set sid of the end record id.
-  // read the last page of the file and get # records in the page.
-  // remeber that the id of the last page is endPid()-1 not endPid().
-  if ((rc = pf.read(--erid.pid, page)) < 0) {
-    // an error occurred during page read
+  // read the dictionary of the values of a DICTIONARY file
+  if (this->format == DICTIONARY && (rc = readDictionary()) < 0) {
     erid.pid = erid.sid = 0;
     pf.close();
     return rc;
   }
 
-  // get # records in the last page
-  erid.sid = getRecordCount(page);
-  if (erid.sid >= RECORDS_PER_PAGE) {
-    // the last page is full. advance the end record id to the next page.
-    erid.pid++;
-    erid.sid = 0;
+  // read the zone map. a file opened for writing keeps it up to date,
+  // so it builds the zone map if there is none. a value filter has
+  // a bit for every 2 bytes of its block, about 10 bits for a record
+  // with a short value in a SLOTTED page
+  filterBytes = FILTER_BLOCK_PAGES * pf.getPageSize() / 16;
+  if ((rc = readZones(mode == 'w' || mode == 'W')) < 0) {
+    erid.pid = erid.sid = 0;
+    pf.close();
+    return rc;
   }
   
   return 0;
@@ -158,65 +316,628 @@ RC RecordFile::open(const string& filename, char mode)
 
 RC RecordFile::close()
 {
+  RC rc;
+
+  // the zone map and the dictionary are written for the records
+  // appended to the file
+  RC zrc = zonesDirty ? writeZones() : 0;
+  zones.clear();
+  filters.clear();
+  zonesValid = zonesDirty = false;
+
+  RC drc = dictDirty ? writeDictionary() : 0;
+  if (zrc == 0) zrc = drc;
+  dict.clear();
+  codes.clear();
+  dictDirty = false;
+
   erid.pid = 0;
   erid.sid = 0;
 
-  return pf.close();
+  rc = pf.close();
+  return (rc < 0) ? rc : zrc;
 }
 
 RC RecordFile::read(const RecordId& rid, int& key, string& value) const
 {
   RC   rc;
-  char page[PageFile::PAGE_SIZE];
+  PageHandle page;
   
   // check whether the rid is in the valid range
   if (rid.pid < 0 || rid.pid > erid.pid) return RC_INVALID_RID;
-  if (rid.sid < 0 || rid.sid >= RecordFile::RECORDS_PER_PAGE) return RC_INVALID_RID;
+  if (rid.sid < 0 || rid.sid >= recordsPerPage) return RC_INVALID_RID;
   if (rid >= erid) return RC_INVALID_RID;
   
-  // read the page containing the record
+  // pin the page containing the record.
+  // the record is read directly from the buffer pool.
   if ((rc = pf.read(rid.pid, page)) < 0) return rc;
 
   // read the record from the slot in the page
-  readSlot(page, rid.sid, key, value);
+  if (format != FIXED) {
+    Scanner::Record r;
+    if (rid.sid >= getRecordCount(page.data())) return RC_INVALID_RID;
+    if (!viewRecord(page.data(), rid.sid, r)) return RC_INVALID_FILE_FORMAT;
+    key = r.key;
+    value.assign(r.value, r.length);
+  } else {
+    readSlot(page.data(), rid.sid, key, value);
+  }
 
   return 0;
 }
 
 RC RecordFile::append(int key, const std::string& value, RecordId& rid)
+{
+  RC rc;
+
+  // an appender of a single record. it reads the end page, adds the
+  // record and writes the page back
+  BulkAppender appender(*this);
+  if ((rc = appender.append(key, value, rid)) < 0) return rc;
+  return appender.flush();
+}
+
+RecordFile::BulkAppender::BulkAppender(RecordFile& rf)
+  : rf(rf)
+{
+  pid = -1;
+  dirty = false;
+}
+
+RecordFile::BulkAppender::~BulkAppender()
+{
+  // the records that are not flushed yet are dropped if the file has
+  // been closed in the meantime. PageFile::write() refuses the page then
+  if (flush() < 0) dirty = false;
+}
+
+RC RecordFile::BulkAppender::append(int key, const std::string& value, RecordId& rid)
 {
   RC   rc;
-  char page[PageFile::PAGE_SIZE];
+  RecordId& erid = rf.erid;
+  int  pageSize = rf.pf.getPageSize();
 
-  // unless we are writing to the the first slot of an empty page,
-  // we have to read the page first
-  if (erid.sid > 0) {
-    if ((rc = pf.read(erid.pid, page)) < 0) return rc;
-  } else {
-    // if this is the first slot of an empty page
-    // we can simply initialize the page with zeros
-    memset(page, 0, PageFile::PAGE_SIZE);
+  // a SLOTTED or PAX record must fit in an empty page
+  if (rf.isSlotted() &&
+      slottedSize(value) > pageSize - (int) sizeof(SlottedHeader)) {
+    return RC_RECORD_TOO_LONG;
+  }
+
+  for (;;) {
+    // the records go to the end page. the page in the buffer is written
+    // once the end page has moved past it
+    if (pid != erid.pid) {
+      if ((rc = flush()) < 0) return rc;
+
+      // unless we are writing to the the first slot of an empty page,
+      // we have to read the page first
+      if (erid.sid > 0) {
+        if ((rc = rf.pf.read(erid.pid, page)) < 0) return rc;
+      } else {
+        // if this is the first slot of an empty page
+        // we can simply initialize the page with zeros
+        memset(page, 0, pageSize);
+        if (rf.isSlotted()) initSlottedPage(page, pageSize);
+      }
+      pid = erid.pid;
+    }
+
+    // a SLOTTED or PAX page is full when the record does not fit in it.
+    // the record then goes to the next page
+    if (!rf.isSlotted() || erid.sid == 0 ||
+        slottedFree(page, rf.format) >= slottedSize(value)) break;
+    erid.pid++;
+    erid.sid = 0;
   }
-    
+
   // write the record to the first empty slot 
-  writeSlot(page, erid.sid, key, value);
+  if (rf.isSlotted()) {
+    writeSlotted(page, rf.format, erid.sid, key, value);
+  } else if (rf.format == DICTIONARY) {
+    codedKeys(page)[erid.sid] = key;
+    codedValues(page, rf.recordsPerPage)[erid.sid] = rf.encode(value);
+  } else {
+    writeSlot(page, erid.sid, key, value);
+  }
 
   // the first four bytes in the page stores # records in the page.
   // update this number.
   setRecordCount(page, erid.sid + 1);
+  dirty = true;
+
+  // the zone map gets the record as it is stored, e.g., truncated
+  Scanner::Record stored;
+  rf.viewRecord(page, erid.sid, stored);
+  if (rf.zonesValid) rf.addToZone(erid.pid, key, stored.value, stored.length);
 
-  // write the page to the disk
-  if ((rc = pf.write(erid.pid, page)) < 0) return rc;
-    
   // we need to output the rid of the record slot
   rid = erid;
 
-  // advance the end record id by one to the next empty slot
-  ++erid;
+  // advance the end record id by one to the next empty slot.
+  // next() is not used for a SLOTTED or PAX file, as it would read the page
+  if (rf.isSlotted()) erid.sid++;
+  else rf.next(erid);
+
+  return 0;
+}
+
+RC RecordFile::BulkAppender::flush()
+{
+  RC rc;
+
+  if (!dirty) return 0;
+
+  // write the page to the disk
+  if ((rc = rf.pf.write(pid, page)) < 0) return rc;
+  dirty = false;
+
+  return 0;
+}
+
+RecordFile::Scanner::Scanner(const RecordFile& rf, int minKey, int maxKey,
+                             const char* value)
+  : rf(rf), records(rf.recordsPerPage)
+{
+  this->minKey = minKey;
+  this->maxKey = maxKey;
+  this->value = value;
+  skipped = skippedBlocks = 0;
+  pid = -1;
+  endPid = INT_MAX;
+}
+
+void RecordFile::Scanner::setPageRange(PageId first, PageId end)
+{
+  pid = first - 1;
+  endPid = end;
+}
+
+RC RecordFile::Scanner::prefetch() const
+{
+  std::vector<PageId> pids;
+  PageId end = (endPid < rf.erid.pid + 1) ? endPid : rf.erid.pid + 1;
+
+  // the pages that the zone map and the value filters do not rule out
+  for (PageId p = pid + 1; p < end; p++) {
+    if (value != NULL && p % FILTER_BLOCK_PAGES == 0 && !rf.mayHaveValue(p, value)) {
+      p += FILTER_BLOCK_PAGES - 1;
+      continue;
+    }
+    if (rf.zonesValid && p < (int) rf.zones.size() &&
+        (rf.zones[p].min > maxKey || rf.zones[p].max < minKey)) continue;
+    pids.push_back(p);
+  }
+  if (pids.empty()) return 0;
+  return rf.pf.prefetch(&pids[0], pids.size());
+}
+
+int RecordFile::Scanner::nextPage()
+{
+  RC  rc;
+  int count;
+  int n;
+
+  // pages without records in the range are passed over
+  do {
+    page.release();
+    for (;;) {
+      // the last page with records is erid.pid, or the one before it if
+      // erid is the first slot of a page
+      pid++;
+      if (pid > rf.erid.pid || (pid == rf.erid.pid && rf.erid.sid == 0)) return 0;
+      if (pid >= endPid) return 0;
+
+      // skip a whole block if its value filter rules the value out.
+      // the scan enters a block at its first page
+      if (value != NULL && pid % FILTER_BLOCK_PAGES == 0 && !rf.mayHaveValue(pid, value)) {
+        PageId end = pid + FILTER_BLOCK_PAGES;
+        if (end > rf.erid.pid + 1) end = rf.erid.pid + 1;
+        if (end > endPid) end = endPid;
+        skipped += end - pid;
+        skippedBlocks++;
+        rf.pf.countSkipped(end - pid, 1);
+        pid = end - 1;
+        continue;
+      }
+
+      // read the page unless its keys are all outside of the range
+      if (!rf.zonesValid || pid >= (int) rf.zones.size()) break;
+      if (rf.zones[pid].min <= maxKey && rf.zones[pid].max >= minKey) break;
+      skipped++;
+      rf.pf.countSkipped(1);
+    }
+
+    // pin the page. the records are read in place
+    if ((rc = rf.pf.read(pid, page)) < 0) return rc;
+
+    count = getRecordCount(page.data());
+    if (count < 0 || count > rf.recordsPerPage) return RC_INVALID_FILE_FORMAT;
+
+    // the records whose keys are in the range
+    if (rf.format == PAX || rf.format == DICTIONARY) {
+      // the keys are compared in the key array of the page. the slots
+      // and the values are touched only for the records in the range.
+      // the loop does not branch on the keys, so a range that matches
+      // about half of them costs no mispredicted branches
+      const int* keys = (rf.format == PAX)
+        ? (const int*)(page.data() + sizeof(SlottedHeader))
+        : codedKeys(const_cast<char*>(page.data()));
+      n = 0;
+      for (int i = 0; i < count; i++) {
+        records[n].sid = i;
+        n += (keys[i] >= minKey) & (keys[i] <= maxKey);
+      }
+      for (int i = 0; i < n; i++) {
+        if (!rf.viewRecord(page.data(), records[i].sid, records[i])) {
+          return RC_INVALID_FILE_FORMAT;
+        }
+      }
+    } else {
+      n = 0;
+      for (int i = 0; i < count; i++) {
+        Record& r = records[n];
+        rf.viewRecord(page.data(), i, r);
+        if (r.key >= minKey && r.key <= maxKey) n++;
+      }
+    }
+  } while (n == 0);
+
+  return n;
+}
+
+bool RecordFile::getKeyRange(PageId pid, int& minKey, int& maxKey) const
+{
+  if (!zonesValid || pid < 0 || pid >= (int) zones.size()) return false;
+
+  // a page without records has an empty range
+  if (zones[pid].min > zones[pid].max) return false;
+  minKey = zones[pid].min;
+  maxKey = zones[pid].max;
+  return true;
+}
+
+bool RecordFile::countRecords(int& count) const
+{
+  // every page of a FIXED or DICTIONARY file but the last one is full
+  if (!isSlotted()) {
+    count = erid.pid * recordsPerPage + erid.sid;
+    return true;
+  }
+
+  // the pages of a SLOTTED or PAX file are counted in the zone map
+  if (!zonesValid) return false;
+  count = recordTotal;
+  return true;
+}
+
+bool RecordFile::getKeyBounds(int& minKey, int& maxKey) const
+{
+  if (!zonesValid || bounds.min > bounds.max) return false;
+  minKey = bounds.min;
+  maxKey = bounds.max;
+  return true;
+}
+
+bool RecordFile::mayHaveValue(PageId pid, const char* value) const
+{
+  int pos[FILTER_HASHES];
+  int block = pid / FILTER_BLOCK_PAGES;
+
+  if (!zonesValid || pid < 0 || (size_t)(block + 1) * filterBytes > filters.size()) return true;
+
+  // the value may be in the block only if all of its bits are set
+  const unsigned char* filter = &filters[(size_t) block * filterBytes];
+  filterBits(value, strlen(value), filterBytes * 8, pos);
+  for (int i = 0; i < FILTER_HASHES; i++) {
+    if (!(filter[pos[i] / 8] & (1 << (pos[i] % 8)))) return false;
+  }
+  return true;
+}
+
+void RecordFile::addToZone(PageId pid, int key, const char* value, int length)
+{
+  int pos[FILTER_HASHES];
+  int block = pid / FILTER_BLOCK_PAGES;
+
+  // a new page starts with an empty range, and a new block
+  // with an empty filter
+  if (pid >= (int) zones.size()) {
+    KeyRange empty = { INT_MAX, INT_MIN };
+    zones.resize(pid + 1, empty);
+  }
+  if ((size_t)(block + 1) * filterBytes > filters.size()) {
+    filters.resize((size_t)(block + 1) * filterBytes, 0);
+  }
+
+  if (key < zones[pid].min) zones[pid].min = key;
+  if (key > zones[pid].max) zones[pid].max = key;
+
+  // the totals of the file
+  recordTotal++;
+  if (key < bounds.min) bounds.min = key;
+  if (key > bounds.max) bounds.max = key;
+
+  unsigned char* filter = &filters[(size_t) block * filterBytes];
+  filterBits(value, length, filterBytes * 8, pos);
+  for (int i = 0; i < FILTER_HASHES; i++) filter[pos[i] / 8] |= 1 << (pos[i] % 8);
+
+  zonesDirty = true;
+}
+
+RC RecordFile::readZones(bool build)
+{
+  ZoneHeader header;
+  FILE*      f;
+  int        n;
+
+  // # pages with records
+  int pages = erid.pid + (erid.sid > 0 ? 1 : 0);
+
+  // # bytes of the value filters
+  size_t bytes = (size_t)((pages + FILTER_BLOCK_PAGES - 1) / FILTER_BLOCK_PAGES) * filterBytes;
+
+  zones.clear();
+  filters.clear();
+  zonesValid = zonesDirty = false;
+  recordTotal = 0;
+  bounds.min = INT_MAX;
+  bounds.max = INT_MIN;
+
+  // the zone map in the file is used only if it was written for this
+  // file, and it ends where the file ends
+  if ((f = fopen(zoneFile.c_str(), "rb")) != NULL) {
+    if (fread(&header, sizeof(header), 1, f) == 1 && header.magic == ZONE_MAGIC &&
+        header.version == ZONE_VERSION && header.dev == (long long) pf.getDevice() &&
+        header.ino == (long long) pf.getInode() && header.end == erid &&
+        header.count == pages && header.filterBytes == filterBytes) {
+      zones.resize(pages);
+      filters.resize(bytes);
+      zonesValid = (pages == 0 ||
+                    (fread(&zones[0], sizeof(KeyRange), pages, f) == (size_t) pages &&
+                     fread(&filters[0], 1, bytes, f) == bytes));
+      recordTotal = header.records;
+      bounds.min = header.minKey;
+      bounds.max = header.maxKey;
+    }
+    fclose(f);
+  }
+  if (zonesValid || !build) {
+    if (!zonesValid) {
+      zones.clear();
+      filters.clear();
+    }
+    return 0;
+  }
+
+  // build the zone map from the records.
+  // the scanner reads all pages while the zone map is not valid
+  Scanner scanner(*this);
+  while ((n = scanner.nextPage()) > 0) {
+    for (int i = 0; i < n; i++) {
+      const Scanner::Record& r = scanner.getRecord(i);
+      addToZone(scanner.getPid(), r.key, r.value, r.length);
+    }
+  }
+  if (n < 0) return n;
+  zonesValid = true;
+  zonesDirty = true;
+
+  return 0;
+}
+
+RC RecordFile::writeZones()
+{
+  ZoneHeader header;
+  FILE*      f;
+  RC         rc = 0;
+
+  // a page without records has an empty range
+  int pages = erid.pid + (erid.sid > 0 ? 1 : 0);
+  KeyRange empty = { INT_MAX, INT_MIN };
+  zones.resize(pages, empty);
+  size_t bytes = (size_t)((pages + FILTER_BLOCK_PAGES - 1) / FILTER_BLOCK_PAGES) * filterBytes;
+  filters.resize(bytes, 0);
+
+  memset(&header, 0, sizeof(header));
+  header.magic = ZONE_MAGIC;
+  header.version = ZONE_VERSION;
+  header.end = erid;
+  header.count = pages;
+  header.filterBytes = filterBytes;
+  header.records = recordTotal;
+  header.minKey = bounds.min;
+  header.maxKey = bounds.max;
+  header.dev = pf.getDevice();
+  header.ino = pf.getInode();
+
+  // a partly written zone map is too short, so it is not used
+  if ((f = fopen(zoneFile.c_str(), "wb")) == NULL) return RC_FILE_WRITE_FAILED;
+  if (fwrite(&header, sizeof(header), 1, f) != 1) rc = RC_FILE_WRITE_FAILED;
+  if (rc == 0 && pages > 0 &&
+      (fwrite(&zones[0], sizeof(KeyRange), pages, f) != (size_t) pages ||
+       fwrite(&filters[0], 1, bytes, f) != bytes)) {
+    rc = RC_FILE_WRITE_FAILED;
+  }
+  if (fclose(f) != 0) rc = RC_FILE_WRITE_FAILED;
+
+  if (rc == 0) zonesDirty = false;
+  return rc;
+}
+
+bool RecordFile::viewRecord(const char* page, int n, Scanner::Record& r) const
+{
+  r.sid = n;
+  r.code = -1;
+  if (format != DICTIONARY) {
+    ::viewRecord(page, format, n, r.key, r.value, r.length);
+    return true;
+  }
+
+  // the value of a DICTIONARY record is looked up by its code
+  char* p = const_cast<char*>(page);
+  r.key = codedKeys(p)[n];
+  r.code = codedValues(p, recordsPerPage)[n];
+  if (r.code < 0 || r.code >= (int) dict.size()) return false;
+  r.value = dict[r.code].data();
+  r.length = dict[r.code].size();
+  return true;
+}
+
+int RecordFile::encode(const std::string& value)
+{
+  // a new value gets the next code
+  std::map<std::string, int>::iterator it = codes.find(value);
+  if (it != codes.end()) return it->second;
+
+  int code = dict.size();
+  dict.push_back(value);
+  codes[value] = code;
+  dictDirty = true;
+  return code;
+}
+
+int RecordFile::getDictionarySize() const
+{
+  return dict.size();
+}
+
+const std::string& RecordFile::getDictionaryValue(int code) const
+{
+  return dict[code];
+}
+
+RC RecordFile::readDictionary()
+{
+  DictHeader header;
+  FILE*      f;
+  int        length;
+  RC         rc = 0;
+  char       buffer[PageFile::MAX_PAGE_SIZE];
+
+  dict.clear();
+  codes.clear();
+  dictDirty = false;
+
+  // a new file has no dictionary yet
+  if ((f = fopen(dictFile.c_str(), "rb")) == NULL) {
+    return (erid.pid == 0 && erid.sid == 0) ? 0 : RC_FILE_OPEN_FAILED;
+  }
+
+  // a dictionary of version 1 does not record its file, and is trusted
+  if (fread(&header, DICT_HEADER_V1, 1, f) != 1 || header.magic != DICT_MAGIC ||
+      header.version < 1 || header.version > DICT_VERSION || header.count < 0 ||
+      (header.version >= 2 &&
+       fread((char*) &header + DICT_HEADER_V1, sizeof(header) - DICT_HEADER_V1, 1, f) != 1)) {
+    rc = RC_INVALID_FILE_FORMAT;
+  } else if (header.version >= 2 && (header.dev != (long long) pf.getDevice() ||
+                                     header.ino != (long long) pf.getInode())) {
+    // the dictionary of another file. an empty file starts a new one
+    fclose(f);
+    return (erid.pid == 0 && erid.sid == 0) ? 0 : RC_INVALID_FILE_FORMAT;
+  }
+  for (int i = 0; rc == 0 && i < header.count; i++) {
+    std::string value;
+    if (fread(&length, sizeof(length), 1, f) != 1 || length < 0) {
+      rc = RC_INVALID_FILE_FORMAT;
+      break;
+    }
+    // the value is read in pieces of the size of the buffer
+    while (length > 0) {
+      int n = (length < (int) sizeof(buffer)) ? length : sizeof(buffer);
+      if (fread(buffer, 1, n, f) != (size_t) n) {
+        rc = RC_INVALID_FILE_FORMAT;
+        break;
+      }
+      value.append(buffer, n);
+      length -= n;
+    }
+    codes[value] = dict.size();
+    dict.push_back(value);
+  }
+  fclose(f);
+
+  if (rc < 0) {
+    dict.clear();
+    codes.clear();
+  }
+  return rc;
+}
+
+RC RecordFile::writeDictionary()
+{
+  DictHeader header;
+  FILE*      f;
+  int        length;
+  RC         rc = 0;
+
+  memset(&header, 0, sizeof(header));
+  header.magic = DICT_MAGIC;
+  header.version = DICT_VERSION;
+  header.count = dict.size();
+  header.dev = pf.getDevice();
+  header.ino = pf.getInode();
+
+  if ((f = fopen(dictFile.c_str(), "wb")) == NULL) return RC_FILE_WRITE_FAILED;
+  if (fwrite(&header, sizeof(header), 1, f) != 1) rc = RC_FILE_WRITE_FAILED;
+  for (unsigned i = 0; rc == 0 && i < dict.size(); i++) {
+    length = dict[i].size();
+    if (fwrite(&length, sizeof(length), 1, f) != 1 ||
+        fwrite(dict[i].data(), 1, length, f) != (size_t) length) {
+      rc = RC_FILE_WRITE_FAILED;
+    }
+  }
+  if (fclose(f) != 0) rc = RC_FILE_WRITE_FAILED;
+
+  if (rc == 0) dictDirty = false;
+  return rc;
+}
+
+RC RecordFile::prefetch(const RecordId* rids, int count) const
+{
+  PageId pids[PREFETCH_BATCH];
+  RC     rc;
+
+  // consecutive records usually share a page, which is prefetched once
+  for (int i = 0; i < count; ) {
+    int n = 0;
+    for (; i < count && n < PREFETCH_BATCH; i++) {
+      if (n == 0 || pids[n-1] != rids[i].pid) pids[n++] = rids[i].pid;
+    }
+    if ((rc = pf.prefetch(pids, n)) < 0) return rc;
+  }
 
   return 0;
 }
 
+RC RecordFile::advise(PageFile::Advice advice) const
+{
+  return pf.advise(advice);
+}
+
+RecordId& RecordFile::next(RecordId& rid) const
+{
+  int count = recordsPerPage;
+
+  // a SLOTTED or PAX page has as many records as it says. # records in
+  // the last page is known without reading it
+  if (isSlotted()) {
+    if (rid.pid == erid.pid) {
+      count = erid.sid;
+    } else {
+      PageHandle page;
+      count = (pf.read(rid.pid, page) < 0) ? 0 : getRecordCount(page.data());
+    }
+  }
+
+  // if the end of a page is reached, move to the next page
+  if (++rid.sid >= count) {
+    rid.pid++;
+    rid.sid = 0;
+  }
+
+  return rid;
+}
+
 const RecordId& RecordFile::endRid() const
 {
   return erid;
@@ -243,7 +964,7 @@ static char* slotPtr(char* page, int n)
   // remember that the first four bytes in a page is used to store
   // # records in the page and each slot consists of an integer and
   // a string of length MAX_VALUE_LENGTH
-  return (page+sizeof(int)) + (sizeof(int)+RecordFile::MAX_VALUE_LENGTH)*n;
+  return (page+sizeof(int)) + RecordFile::SLOT_SIZE*n;
 }
 
 static void readSlot(const char* page, int n, int& key, std::string& value)
@@ -275,3 +996,106 @@ static void writeSlot(char* page, int n, int key, const std::string& value)
     strcpy(ptr + sizeof(int), value.c_str());
   }
 }
+
+static void initSlottedPage(char* page, int pageSize)
+{
+  SlottedHeader header;
+
+  // no records, and the records grow from the end of the page
+  header.count = 0;
+  header.dataStart = pageSize;
+  memcpy(page, &header, sizeof(header));
+}
+
+static int slottedSize(const std::string& value)
+{
+  // a slot, the key and the value
+  return sizeof(Slot) + sizeof(int) + value.size();
+}
+
+static int slottedFree(const char* page, RecordFile::Format format)
+{
+  SlottedHeader header;
+  int perRecord = sizeof(Slot) + (format == RecordFile::PAX ? sizeof(int) : 0);
+
+  // the space between the slot directory and the records
+  memcpy(&header, page, sizeof(header));
+  return header.dataStart - sizeof(header) - header.count * perRecord;
+}
+
+static void writeSlotted(char* page, RecordFile::Format format, int n,
+                         int key, const std::string& value)
+{
+  SlottedHeader header;
+  Slot  slot;
+  char* slots;
+
+  memcpy(&header, page, sizeof(header));
+
+  if (format == RecordFile::PAX) {
+    // the value goes right before the values already in the page, and
+    // the key at the end of the key array. the slot directory moves
+    // to make room for the key
+    header.dataStart -= value.size();
+    slot.offset = header.dataStart;
+    slot.length = value.size();
+    slots = page + sizeof(SlottedHeader) + (n + 1) * sizeof(int);
+    memmove(slots, slots - sizeof(int), n * sizeof(Slot));
+    memcpy(slots - sizeof(int), &key, sizeof(int));
+    memcpy(page + slot.offset, value.data(), value.size());
+  } else {
+    // the record goes right before the records already in the page
+    header.dataStart -= sizeof(int) + value.size();
+    slot.offset = header.dataStart;
+    slot.length = value.size();
+    slots = page + sizeof(SlottedHeader);
+    memcpy(page + slot.offset, &key, sizeof(int));
+    memcpy(page + slot.offset + sizeof(int), value.data(), value.size());
+  }
+
+  // store the slot
+  memcpy(slots + n * sizeof(Slot), &slot, sizeof(slot));
+  memcpy(page, &header, sizeof(header));
+}
+
+static void viewRecord(const char* page, RecordFile::Format format, int n,
+                       int& key, const char*& value, int& length)
+{
+  Slot slot;
+
+  if (format == RecordFile::SLOTTED) {
+    // the slot tells where the record is and how long its value is
+    memcpy(&slot, page + sizeof(SlottedHeader) + n * sizeof(Slot), sizeof(slot));
+    memcpy(&key, page + slot.offset, sizeof(int));
+    value = page + slot.offset + sizeof(int);
+    length = slot.length;
+  } else if (format == RecordFile::PAX) {
+    // the key is in the key array, and the slots follow the array
+    const char* slots = page + sizeof(SlottedHeader) + getRecordCount(page) * sizeof(int);
+    memcpy(&key, page + sizeof(SlottedHeader) + n * sizeof(int), sizeof(int));
+    memcpy(&slot, slots + n * sizeof(Slot), sizeof(slot));
+    value = page + slot.offset;
+    length = slot.length;
+  } else {
+    // the value in a slot is null-terminated
+    const char* ptr = slotPtr(const_cast<char*>(page), n);
+    memcpy(&key, ptr, sizeof(int));
+    value = ptr + sizeof(int);
+    length = strlen(value);
+  }
+}
+
+static void filterBits(const char* value, int length, int bits, int* pos)
+{
+  // the 64-bit FNV-1a hash of the value. its two halves make
+  // FILTER_HASHES hashes by double hashing
+  unsigned long long h = 14695981039346656037ULL;
+  for (int i = 0; i < length; i++) {
+    h ^= (unsigned char) value[i];
+    h *= 1099511628211ULL;
+  }
+
+  unsigned h1 = (unsigned) h;
+  unsigned h2 = (unsigned)(h >> 32) | 1;
+  for (int i = 0; i < FILTER_HASHES; i++) pos[i] = (h1 + i * h2) % bits;
+}
@@ -11,6 +11,9 @@
 #define RECORDFILE_H
 
 #include <string>
+#include <vector>
+#include <map>
+#include <climits>
 #include "PageFile.h"
 
 /**
@@ -26,7 +29,9 @@ typedef struct {
 // helper functions for RecordId
 // 
 
-// RecordId iterators
+// record id iterators. deprecated: they assume a FIXED file with the
+// default page size, i.e., RecordFile::RECORDS_PER_PAGE slots per page.
+// use RecordFile::next(), which works for any format and page size
 RecordId& operator++ (RecordId& rid);
 RecordId  operator++ (RecordId& rid, int);
 
@@ -39,18 +44,64 @@ bool operator== (const RecordId& r1, const RecordId& r2);
 bool operator!= (const RecordId& r1, const RecordId& r2);
 
 /**
- * read/write a record to a file
+ * read/write a record to a file.
+ * the records of a file are stored in one of two formats, chosen when
+ * the file is created:
+ *  - FIXED: a page is divided into slots of SLOT_SIZE bytes, and a value
+ *    longer than MAX_VALUE_LENGTH-1 bytes is truncated. files created
+ *    before the format became selectable are in this format.
+ *  - SLOTTED: a page has a slot directory, and each record takes only
+ *    the bytes of its key and its value. a page holds as many records as
+ *    fit, and a value may be as long as a page can hold.
+ *  - PAX: a SLOTTED page whose keys are stored together in an array at
+ *    the beginning of the page, followed by the slots and the values.
+ *    a scan compares the keys in the array and touches the values only
+ *    of the records whose keys are in its range.
+ *  - DICTIONARY: for a table with few distinct values. a value is stored
+ *    once in the dictionary of the file, named <filename>.dict, and a
+ *    record stores the code of its value. a page has an array of keys and
+ *    an array of codes, each with getRecordsPerPage() entries. the values
+ *    are not truncated, and records with the same value may be compared
+ *    by their codes.
+ * in all formats, the sid of a RecordId is the position of the record
+ * in its page.
+ *
+ * a RecordFile keeps a zone map, i.e., the smallest and the largest key
+ * of each page, in a file next to it, named <filename>.zone. the zone map
+ * is kept up to date by the appends to the file, and it is written when
+ * the file is closed. the zone map also has a value filter, a Bloom
+ * filter of the values, for each block of FILTER_BLOCK_PAGES pages. a scan
+ * for records with a given value skips the blocks whose filter rules the
+ * value out. a file opened in 'w' mode without an up-to-date
+ * zone map gets one built from its pages. a file opened for reading
+ * without one is read as if it had no zone map. the zone map also keeps
+ * # records and the smallest and the largest key of the whole file.
+ *
+ * the zone map and the dictionary record the device and inode of the
+ * file they were written for, and are not used for another file of the
+ * same name. they are removed when an empty file is opened in 'w' mode.
  */
 class RecordFile {
  public:
 
+  // the layout of the records in the pages of a file
+  enum Format { FIXED, SLOTTED, PAX, DICTIONARY };
+
   // maximum length of the value field
   static const int MAX_VALUE_LENGTH = 100;  
 
-  // number of record slots per page
-  static const int RECORDS_PER_PAGE = (PageFile::PAGE_SIZE - sizeof(int))/ (sizeof(int) + MAX_VALUE_LENGTH);  
-    // Note that we subtract sizeof(int) from PAGE_SIZE because the first
-    // four bytes in the page is used to store # records in the page.
+  // size of a record slot: the key and the value
+  static const int SLOT_SIZE = sizeof(int) + MAX_VALUE_LENGTH;
+
+  // # record slots in a page of a FIXED file with the default page size.
+  // deprecated: use getRecordsPerPage(), which depends on the file
+  static const int RECORDS_PER_PAGE = (PageFile::DEFAULT_PAGE_SIZE - sizeof(int)) / SLOT_SIZE;
+
+  // maximum # records whose pages are read together by prefetch()
+  static const int PREFETCH_BATCH = 64;
+
+  // # pages in a block of the zone map with one value filter
+  static const int FILTER_BLOCK_PAGES = 8;
 
   RecordFile();
   RecordFile(const std::string& filename, char mode);
@@ -58,11 +109,17 @@ class RecordFile {
   /**
    * open a file in read or write mode.
    * when opened in 'w' mode, if the file does not exist, it is created.
+   * 'm' mode is a read-only mode that memory-maps the file.
    * @param filename[IN] the name of the file to open
-   * @param mode[IN] 'r' for read, 'w' for write
+   * @param mode[IN] 'r' for read, 'w' for write, 'm' for mapped read
+   * @param pageSize[IN] the page size of a new file. 0 for the default
+   * @param compress[IN] true to compress the pages of a new file
+   * @param format[IN] the record format of a new file. the format of
+   *                   an existing file is read from the file
    * @return error code. 0 if no error
    */
-  RC open(const std::string& filename, char mode);
+  RC open(const std::string& filename, char mode, int pageSize = 0,
+          bool compress = false, Format format = FIXED);
 
   /**
    * close the file.
@@ -86,10 +143,236 @@ class RecordFile {
    * @param key[IN] the record key
    * @param value[IN] the record value
    * @param rid[OUT] the location of the stored record
-   * @return error code. 0 if no error
+   * @return error code. 0 if no error. RC_RECORD_TOO_LONG if the file is
+   *         SLOTTED or PAX and the record does not fit in an empty page
    */
   RC append(int key, const std::string& value, RecordId& rid);
 
+  /**
+   * appends many records to a RecordFile, e.g., during a load.
+   * the end page of the file is filled in memory, and it is written to
+   * the file once, when it is full or when flush() is called. append()
+   * of RecordFile instead reads and writes the end page for each record.
+   * the appended records cannot be read from the file before flush(),
+   * and RecordFile::append() must not be called while the appender has
+   * records that are not flushed.
+   */
+  class BulkAppender {
+   public:
+    BulkAppender(RecordFile& rf);
+
+    /**
+     * flush the appended records, if the file is still open.
+     * otherwise they are lost, so call flush() before the file is closed.
+     */
+    ~BulkAppender();
+
+    /**
+     * append a new record at the end of the file.
+     * @param key[IN] the record key
+     * @param value[IN] the record value
+     * @param rid[OUT] the location of the stored record
+     * @return error code. 0 if no error. RC_RECORD_TOO_LONG if the file
+     *         is SLOTTED or PAX and the record does not fit in an empty page
+     */
+    RC append(int key, const std::string& value, RecordId& rid);
+
+    /**
+     * write the page of the last appended records to the file.
+     * call it before the file is closed.
+     * @return error code. 0 if no error
+     */
+    RC flush();
+
+   private:
+    RecordFile& rf;   // the file to append to
+    PageId pid;       // the page in the buffer. -1 if none
+    bool   dirty;     // true if the buffer is not written yet
+    char   page[PageFile::MAX_PAGE_SIZE]; // the end page of the file
+  };
+
+  /**
+   * reads the records of a file page by page, e.g., for a table scan.
+   * each page is fetched from the buffer pool once, and it stays pinned
+   * while its records are examined. the records are returned in place,
+   * so a value is a pointer into the page and not a copy.
+   */
+  class Scanner {
+   public:
+    // a record of the current page. value is valid until the next page
+    // is read, and it is not null-terminated
+    struct Record {
+      int sid;            // the slot of the record in the page
+      int key;            // the record key
+      const char* value;  // the first byte of the record value
+      int length;         // # bytes of the value
+      int code;           // the code of the value in a DICTIONARY file.
+                          // -1 in the other formats
+    };
+
+    /**
+     * start a scan of the file from its first page.
+     * the pages whose keys are all outside of [minKey, maxKey] are
+     * skipped according to the zone map of the file, if it has one.
+     * the records outside of the range are left out of the pages read.
+     * if value is given, the blocks whose value filter rules the value
+     * out are skipped as well.
+     * @param rf[IN] the file to scan
+     * @param minKey[IN] the smallest key the scan looks for
+     * @param maxKey[IN] the largest key the scan looks for
+     * @param value[IN] the value the scan looks for. NULL for any value
+     */
+    Scanner(const RecordFile& rf, int minKey = INT_MIN, int maxKey = INT_MAX,
+            const char* value = NULL);
+
+    /**
+     * limit the scan to a range of pages, e.g., the part of the file
+     * scanned by one thread of a parallel scan. it is called before the
+     * first nextPage(). a range that starts in the middle of a block is
+     * not skipped by the value filter.
+     * @param first[IN] the first page to scan
+     * @param end[IN] the page after the last page to scan
+     */
+    void setPageRange(PageId first, PageId end);
+
+    /**
+     * read the pages that are left to scan together, except those ruled
+     * out by the zone map. the readahead of the file does not follow the
+     * reads of a scan thread when other threads read the file as well.
+     * @return error code. 0 if no error
+     */
+    RC prefetch() const;
+
+    /**
+     * move to the next page of the file with records in the key range,
+     * and read those records. the records of the previous page become
+     * invalid.
+     * @return # records read from the page. 0 at the end of the file, and
+     *         a negative error code if the page could not be read
+     */
+    int nextPage();
+
+    /**
+     * @param n[IN] the position of the record among the records read
+     *              from the current page
+     * @return the n'th record read from the current page
+     */
+    const Record& getRecord(int n) const { return records[n]; }
+
+    /**
+     * @return the current page. the rid of a record read from it is
+     *         (pid, sid of the record)
+     */
+    PageId getPid() const { return pid; }
+
+    /**
+     * @return # pages skipped so far by the zone map
+     */
+    int getSkippedPages() const { return skipped; }
+
+    /**
+     * @return # blocks skipped so far by the value filters
+     */
+    int getSkippedBlocks() const { return skippedBlocks; }
+
+   private:
+    const RecordFile& rf;         // the file to scan
+    int        minKey, maxKey;    // the range of keys of the scan
+    const char* value;            // the value of the scan. NULL for any
+    int        skipped;           // # pages skipped by the zone map
+    int        skippedBlocks;     // # blocks skipped by the value filters
+    PageId     pid;               // the current page. -1 before the first
+    PageId     endPid;            // the page after the last page to scan
+    PageHandle page;              // the current page, pinned
+    std::vector<Record> records;  // the records of the current page
+  };
+
+  /**
+   * read the pages of a batch of records ahead of use, in parallel.
+   * the records are then read with read() without waiting for the disk.
+   * @param rids[IN] the records that are going to be read
+   * @param count[IN] # records in rids
+   * @return error code. 0 if no error
+   */
+  RC prefetch(const RecordId* rids, int count) const;
+
+  /**
+   * tell the kernel how the records are going to be read,
+   * e.g., SEQUENTIAL for a table scan.
+   * @param advice[IN] the expected access pattern
+   * @return error code. 0 if no error
+   */
+  RC advise(PageFile::Advice advice) const;
+
+  /**
+   * move rid to the next record slot of the file.
+   * in a SLOTTED or PAX file, the page of rid is read to find its last record.
+   * @param rid[IN/OUT] the record id to advance
+   * @return rid
+   */
+  RecordId& next(RecordId& rid) const;
+
+  /**
+   * @return # record slots in a page of a FIXED file. the first four bytes
+   * of a page store # records in the page, and the rest is divided
+   * into slots. for a SLOTTED or PAX file, the most records that fit in a page,
+   * i.e., records with empty values
+   */
+  int getRecordsPerPage() const { return recordsPerPage; }
+
+  /**
+   * @return the record format of the file
+   */
+  Format getFormat() const { return format; }
+
+  /**
+   * get the range of the keys in a page from the zone map of the file.
+   * @param pid[IN] the page
+   * @param minKey[OUT] the smallest key in the page
+   * @param maxKey[OUT] the largest key in the page
+   * @return true if the range is known. false if the file has no
+   *         zone map or the page has no records
+   */
+  bool getKeyRange(PageId pid, int& minKey, int& maxKey) const;
+
+  /**
+   * count the records of the file without reading its pages.
+   * @param count[OUT] # records in the file
+   * @return true if the count is known. false if the file is SLOTTED or
+   *         PAX and it has no zone map
+   */
+  bool countRecords(int& count) const;
+
+  /**
+   * get the smallest and the largest key of the file from its zone map.
+   * @param minKey[OUT] the smallest key in the file
+   * @param maxKey[OUT] the largest key in the file
+   * @return true if the keys are known. false if the file has no
+   *         zone map or no records
+   */
+  bool getKeyBounds(int& minKey, int& maxKey) const;
+
+  /**
+   * check the value filter of the block of a page for a value.
+   * @param pid[IN] a page in the block
+   * @param value[IN] the value
+   * @return false if no record in the block has the value. true if
+   *         some record may have it, or if the file has no zone map
+   */
+  bool mayHaveValue(PageId pid, const char* value) const;
+
+  /**
+   * @return # values in the dictionary of a DICTIONARY file. the codes
+   *         of the values are 0 to getDictionarySize()-1
+   */
+  int getDictionarySize() const;
+
+  /**
+   * @param code[IN] a code of the dictionary of a DICTIONARY file
+   * @return the value of the code
+   */
+  const std::string& getDictionaryValue(int code) const;
+
   /**
    * note the +1 part. The rid of the last record is endRid()-1.
    * @return (last record id + 1) of the RecordFile
@@ -99,6 +382,52 @@ class RecordFile {
  private:
   PageFile pf;     // the PageFile used to store the records
   RecordId erid;   // the last record id of the file + 1
+  int recordsPerPage; // # record slots in a page
+  Format format;   // the record format of the file
+
+  // true if the records are in a slot directory, i.e., SLOTTED or PAX
+  bool isSlotted() const { return format == SLOTTED || format == PAX; }
+
+  // find the n'th record in a page of the file. false if the page is corrupt
+  bool viewRecord(const char* page, int n, Scanner::Record& r) const;
+
+  // the smallest and the largest key of the records in a page
+  struct KeyRange {
+    int min;
+    int max;
+  };
+
+  // read the zone map from its file, or build it from the pages
+  RC readZones(bool build);
+
+  // write the zone map to its file
+  RC writeZones();
+
+  // add a record to the zone map
+  void addToZone(PageId pid, int key, const char* value, int length);
+
+  std::string zoneFile;   // the name of the file of the zone map
+  std::vector<KeyRange> zones; // the key range of each page
+  std::vector<unsigned char> filters; // the value filter of each block
+  int  filterBytes; // # bytes in the value filter of a block
+  bool zonesValid;  // true if zones covers all pages of the file
+  bool zonesDirty;  // true if zones is not written to zoneFile yet
+  int  recordTotal; // # records in the file, if zonesValid
+  KeyRange bounds;  // the range of all keys in the file, if zonesValid
+
+  // read the dictionary from its file
+  RC readDictionary();
+
+  // write the dictionary to its file
+  RC writeDictionary();
+
+  // the code of a value. a new value is added to the dictionary
+  int encode(const std::string& value);
+
+  std::string dictFile;           // the name of the file of the dictionary
+  std::vector<std::string> dict;  // the value of each code
+  std::map<std::string, int> codes; // the code of each value
+  bool dictDirty;   // true if dict is not written to dictFile yet
 };
 
 #endif // RECORDFILE_H
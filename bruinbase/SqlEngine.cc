@@ -8,6 +8,11 @@
  */
 
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <climits>
+#include <algorithm>
+#include <pthread.h>
 #include <iostream>
 #include <fstream>
 #include "Bruinbase.h"
@@ -20,6 +25,14 @@ using namespace std;
 extern FILE* sqlin;
 int sqlparse(void);
 
+// compare a value of the given length with a string, as strcmp() does
+static int compareValue(const char* value, int length, const char* s)
+{
+  int n = strlen(s);
+  int diff = memcmp(value, s, (length < n) ? length : n);
+  return diff ? diff : length - n;
+}
+
 
 RC SqlEngine::run(FILE* commandline)
 {
@@ -33,6 +46,444 @@ RC SqlEngine::run(FILE* commandline)
   return 0;
 }
 
+// find the range of keys that can meet the conditions on the key
+static void getKeyRange(const vector<SelCond>& cond, int& minKey, int& maxKey)
+{
+  minKey = INT_MIN;
+  maxKey = INT_MAX;
+
+  for (unsigned i = 0; i < cond.size(); i++) {
+    if (cond[i].attr != 1) continue;
+
+    int v = atoi(cond[i].value);
+    switch (cond[i].comp) {
+    case SelCond::EQ:
+      if (v > minKey) minKey = v;
+      if (v < maxKey) maxKey = v;
+      break;
+    case SelCond::GT:
+      // no key is greater than INT_MAX
+      if (v == INT_MAX) {
+        minKey = INT_MAX;
+        maxKey = INT_MIN;
+      } else if (v + 1 > minKey) minKey = v + 1;
+      break;
+    case SelCond::GE:
+      if (v > minKey) minKey = v;
+      break;
+    case SelCond::LT:
+      // no key is less than INT_MIN
+      if (v == INT_MIN) {
+        minKey = INT_MAX;
+        maxKey = INT_MIN;
+      } else if (v - 1 < maxKey) maxKey = v - 1;
+      break;
+    case SelCond::LE:
+      if (v < maxKey) maxKey = v;
+      break;
+    case SelCond::NE:
+      break;
+    }
+  }
+}
+
+// check the conditions on a tuple of a table scan
+static bool checkConds(const RecordFile::Scanner::Record& rec, const vector<SelCond>& cond,
+                       const vector< vector<int> >& codeDiff)
+{
+  int diff = 0;
+
+  for (unsigned i = 0; i < cond.size(); i++) {
+    // compute the difference between the tuple and the condition value
+    switch (cond[i].attr) {
+    case 1:
+      diff = rec.key - atoi(cond[i].value);
+      break;
+    case 2:
+      if (rec.code >= 0) diff = codeDiff[i][rec.code];
+      else diff = compareValue(rec.value, rec.length, cond[i].value);
+      break;
+    }
+
+    // the tuple is skipped if any condition is not met
+    switch (cond[i].comp) {
+    case SelCond::EQ:
+      if (diff != 0) return false;
+      break;
+    case SelCond::NE:
+      if (diff == 0) return false;
+      break;
+    case SelCond::GT:
+      if (diff <= 0) return false;
+      break;
+    case SelCond::LT:
+      if (diff >= 0) return false;
+      break;
+    case SelCond::GE:
+      if (diff < 0) return false;
+      break;
+    case SelCond::LE:
+      if (diff > 0) return false;
+      break;
+    }
+  }
+  return true;
+}
+
+//
+// a table scan is divided into morsels of MORSEL_PAGES pages, which the
+// scan threads take in turn. each morsel collects the output of its
+// tuples, and the thread of the SELECT prints the output of the morsels
+// in the order of the table, or in the order they are finished
+//
+
+// # pages of a morsel. a morsel starts at the first page of a block of
+// the value filters, so that the whole blocks can be skipped
+static const int MORSEL_PAGES = 8 * RecordFile::FILTER_BLOCK_PAGES;
+
+// # morsels per scan thread that may be taken before they are printed.
+// a thread waits before it takes a morsel further ahead of the printed
+// ones, so the output kept in memory is bounded even when the morsels
+// finish far out of order, or faster than they are printed
+static const int MORSEL_WINDOW = 4;
+
+// the result of a morsel
+struct Morsel {
+  string output;    // the printed tuples
+  int    count;     // # matching tuples
+  int    smallest;  // the smallest key of the matching tuples
+  int    largest;   // the largest key of the matching tuples
+  RC     rc;        // error code of the scan of the morsel
+  bool   done;      // true if the morsel is scanned
+};
+
+// the state of a table scan shared by its threads
+struct ScanJob {
+  // the scan
+  const RecordFile* rf;
+  const vector<SelCond>* cond;
+  const vector< vector<int> >* codeDiff;
+  int attr;
+  int minKey, maxKey;       // the range of keys that can meet the conditions
+  const char* eqValue;      // the value of an equality condition. NULL if none
+  bool prefetch;            // true if each morsel is prefetched
+  IOStats::Query* query;    // the query the threads count their reads for
+
+  // the morsels. next is taken with an atomic increment
+  vector<Morsel> morsels;
+  int next;                 // the next morsel to scan
+  vector<int> finished;     // the morsels in the order they are finished
+  int printed;              // # morsels printed
+  int window;               // # morsels that may be ahead of the printed ones
+  pthread_mutex_t lock;     // protects done of the morsels, finished and printed
+  pthread_cond_t  ready;    // signaled when a morsel is finished
+  pthread_cond_t  room;     // signaled when a morsel is printed
+
+  // the result of the scan
+  int count, smallest, largest;
+};
+
+int SqlEngine::scanThreads = 1;
+bool SqlEngine::orderedScan = true;
+
+void SqlEngine::setScanThreads(int threads)
+{
+  if (threads < 1) threads = 1;
+  if (threads > MAX_SCAN_THREADS) threads = MAX_SCAN_THREADS;
+  scanThreads = threads;
+}
+
+void SqlEngine::setOrderedScan(bool ordered)
+{
+  orderedScan = ordered;
+}
+
+// scan a morsel of the table, and collect its output
+static void scanMorsel(const ScanJob& job, int m, Morsel& morsel)
+{
+  RecordFile::Scanner scanner(*job.rf, job.minKey, job.maxKey, job.eqValue);
+  char buffer[32];
+  int  n;
+
+  morsel.count = 0;
+  scanner.setPageRange(m * MORSEL_PAGES, (m + 1) * MORSEL_PAGES);
+  if (job.prefetch && (morsel.rc = scanner.prefetch()) < 0) return;
+
+  // the records of a page are examined in place, without copying them
+  while ((n = scanner.nextPage()) != 0) {
+    if (n < 0) {
+      morsel.rc = n;
+      return;
+    }
+
+    for (int r = 0; r < n; r++) {
+      const RecordFile::Scanner::Record& rec = scanner.getRecord(r);
+      if (!checkConds(rec, *job.cond, *job.codeDiff)) continue;
+
+      // the condition is met for the tuple
+      if (morsel.count == 0 || rec.key < morsel.smallest) morsel.smallest = rec.key;
+      if (morsel.count == 0 || rec.key > morsel.largest) morsel.largest = rec.key;
+      morsel.count++;
+
+      // print the tuple
+      switch (job.attr) {
+      case 1:  // SELECT key
+        sprintf(buffer, "%d\n", rec.key);
+        morsel.output += buffer;
+        break;
+      case 2:  // SELECT value
+        morsel.output.append(rec.value, rec.length);
+        morsel.output += '\n';
+        break;
+      case 3:  // SELECT *
+        sprintf(buffer, "%d '", rec.key);
+        morsel.output += buffer;
+        morsel.output.append(rec.value, rec.length);
+        morsel.output += "'\n";
+        break;
+      }
+    }
+  }
+}
+
+// the main function of a scan thread
+static void* scanWorker(void* arg)
+{
+  ScanJob& job = *(ScanJob*) arg;
+  int m;
+
+  IOStats::setQuery(job.query);
+  while ((m = __sync_fetch_and_add(&job.next, 1)) < (int) job.morsels.size()) {
+    // wait until the morsel is within the window of the printed ones.
+    // all morsels count as printed once the scan has stopped on an error
+    pthread_mutex_lock(&job.lock);
+    while (m >= job.printed + job.window) pthread_cond_wait(&job.room, &job.lock);
+    bool stopped = (job.printed == (int) job.morsels.size());
+    pthread_mutex_unlock(&job.lock);
+    if (stopped) break;
+
+    scanMorsel(job, m, job.morsels[m]);
+
+    pthread_mutex_lock(&job.lock);
+    job.morsels[m].done = true;
+    job.finished.push_back(m);
+    pthread_cond_broadcast(&job.ready);
+    pthread_mutex_unlock(&job.lock);
+  }
+  return NULL;
+}
+
+// scan the table with the scan threads, and print the matching tuples.
+// a table of one morsel, or a single scan thread, is scanned without
+// starting a thread
+static RC runScan(ScanJob& job, int threads, bool ordered)
+{
+  const RecordId& end = job.rf->endRid();
+  int pages = end.pid + (end.sid > 0 ? 1 : 0);
+  vector<pthread_t> workers;
+  RC rc = 0;
+
+  job.morsels.resize((pages + MORSEL_PAGES - 1) / MORSEL_PAGES);
+  for (unsigned m = 0; m < job.morsels.size(); m++) job.morsels[m].done = false;
+  job.next = 0;
+  job.printed = 0;
+  job.count = 0;
+  pthread_mutex_init(&job.lock, NULL);
+  pthread_cond_init(&job.ready, NULL);
+  pthread_cond_init(&job.room, NULL);
+
+  // the readahead of the file follows a single thread. the threads of a
+  // parallel scan prefetch their morsels instead
+  if (threads > (int) job.morsels.size()) threads = job.morsels.size();
+  job.prefetch = (threads > 1);
+  job.query = IOStats::getQuery();
+  job.window = threads * MORSEL_WINDOW;
+  job.rf->advise(job.prefetch ? PageFile::RANDOM : PageFile::SEQUENTIAL);
+  for (int i = 0; threads > 1 && i < threads; i++) {
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, scanWorker, &job) == 0) workers.push_back(thread);
+  }
+
+  for (unsigned i = 0; i < job.morsels.size(); i++) {
+    int m;
+
+    if (workers.empty()) {
+      // no scan thread. the morsels are scanned here in order
+      m = i;
+      scanMorsel(job, m, job.morsels[m]);
+    } else {
+      // wait for the next morsel in the order of the output
+      pthread_mutex_lock(&job.lock);
+      if (ordered) {
+        m = i;
+        while (!job.morsels[m].done) pthread_cond_wait(&job.ready, &job.lock);
+      } else {
+        while (job.finished.size() <= i) pthread_cond_wait(&job.ready, &job.lock);
+        m = job.finished[i];
+      }
+      pthread_mutex_unlock(&job.lock);
+    }
+
+    // the scan stops at the first error. the threads finish the
+    // morsels they have taken, and they take no more
+    // the threads waiting for room are let go, to find no morsel left
+    Morsel& morsel = job.morsels[m];
+    if (morsel.rc < 0) {
+      rc = morsel.rc;
+      __sync_lock_test_and_set(&job.next, (int) job.morsels.size());
+      pthread_mutex_lock(&job.lock);
+      job.printed = job.morsels.size();
+      pthread_cond_broadcast(&job.room);
+      pthread_mutex_unlock(&job.lock);
+      break;
+    }
+
+    fwrite(morsel.output.data(), 1, morsel.output.size(), stdout);
+    string().swap(morsel.output);
+    if (!workers.empty()) {
+      pthread_mutex_lock(&job.lock);
+      job.printed++;
+      pthread_cond_broadcast(&job.room);
+      pthread_mutex_unlock(&job.lock);
+    }
+    if (morsel.count > 0) {
+      if (job.count == 0 || morsel.smallest < job.smallest) job.smallest = morsel.smallest;
+      if (job.count == 0 || morsel.largest > job.largest) job.largest = morsel.largest;
+      job.count += morsel.count;
+    }
+  }
+
+  for (unsigned i = 0; i < workers.size(); i++) pthread_join(workers[i], NULL);
+  pthread_mutex_destroy(&job.lock);
+  pthread_cond_destroy(&job.ready);
+  pthread_cond_destroy(&job.room);
+  return rc;
+}
+
+//
+// an index range scan reads the tuples of its entries in key order, which
+// is a random order of the table pages. a large range instead collects
+// its entries in batches, sorts each batch by rid, and reads each table
+// page once per batch. the matching tuples are sorted back by key if
+// they are printed
+//
+
+// the estimated # tuples of a range from which its tuples are read in
+// rid order
+static const int RID_ORDER_MIN_TUPLES = 4 * RecordFile::PREFETCH_BATCH;
+
+// # index entries that the rid-order fetch sorts at a time
+static const int RID_ORDER_BATCH = 64 * RecordFile::PREFETCH_BATCH;
+
+// an index entry, and the value of its tuple once it is read
+struct IndexEntry {
+  int      key;
+  RecordId rid;
+  string   value;
+};
+
+static bool ridLess(const IndexEntry& e1, const IndexEntry& e2)
+{
+  return e1.rid < e2.rid;
+}
+
+static bool keyLess(const IndexEntry& e1, const IndexEntry& e2)
+{
+  return e1.key < e2.key;
+}
+
+// estimate # tuples whose keys are in [minKey, maxKey] from the record
+// count and the key bounds of the table, assuming the keys are uniform.
+// -1 if the table has no zone map
+static int estimateTuples(const RecordFile& rf, int minKey, int maxKey)
+{
+  int count, lo, hi;
+
+  if (!rf.countRecords(count) || !rf.getKeyBounds(lo, hi)) return -1;
+  if (minKey < lo) minKey = lo;
+  if (maxKey > hi) maxKey = hi;
+  if (minKey > maxKey) return 0;
+  return (int)(count * (((double) maxKey - minKey + 1) / ((double) hi - lo + 1)));
+}
+
+// read the tuples of the index entries from the cursor up to maxKey in
+// rid order, and print the matching tuples in key order.
+// the entries are taken RID_ORDER_BATCH at a time in key order, so the
+// memory is bounded, and the tuples of each batch are printed before the
+// next batch is read
+static RC fetchInRidOrder(const RecordFile& rf, BTreeIndex& index, IndexCursor& cursor,
+                          int maxKey, int attr, const vector<SelCond>& cond,
+                          int& count, int& smallest, int& largest)
+{
+  vector<IndexEntry> entries;
+  vector< vector<int> > codeDiff(cond.size());
+  RecordId rids[RecordFile::PREFETCH_BATCH];
+  IndexEntry e;
+  bool done = false;
+  RC rc;
+
+  count = 0;
+  entries.reserve(RID_ORDER_BATCH);
+  while (!done) {
+    // collect the next batch of entries of the range
+    entries.clear();
+    while (entries.size() < (unsigned) RID_ORDER_BATCH) {
+      if (index.readForward(cursor, e.key, e.rid) || e.key > maxKey) {
+        done = true;
+        break;
+      }
+      entries.push_back(e);
+    }
+    sort(entries.begin(), entries.end(), ridLess);
+
+    // read the tuples page by page. the pages of a batch are read together
+    int matched = 0;
+    for (unsigned i = 0; i < entries.size(); i++) {
+      if (i % RecordFile::PREFETCH_BATCH == 0) {
+        int n = 0;
+        for (unsigned j = i; j < entries.size() && n < RecordFile::PREFETCH_BATCH; j++) {
+          rids[n++] = entries[j].rid;
+        }
+        rf.prefetch(rids, n);
+      }
+
+      IndexEntry& entry = entries[i];
+      if ((rc = rf.read(entry.rid, entry.key, entry.value)) < 0) return rc;
+
+      RecordFile::Scanner::Record rec;
+      rec.sid = entry.rid.sid;
+      rec.key = entry.key;
+      rec.value = entry.value.data();
+      rec.length = entry.value.size();
+      rec.code = -1;
+      if (!checkConds(rec, cond, codeDiff)) continue;
+
+      if (count == 0 || entry.key < smallest) smallest = entry.key;
+      if (count == 0 || entry.key > largest) largest = entry.key;
+      count++;
+      entries[matched++] = entry;
+    }
+    entries.resize(matched);
+
+    // the tuples of equal keys stay in rid order, as in the index
+    if (attr <= 3) stable_sort(entries.begin(), entries.end(), keyLess);
+    for (int i = 0; i < matched; i++) {
+      switch (attr) {
+      case 1:  // SELECT key
+        fprintf(stdout, "%d\n", entries[i].key);
+        break;
+      case 2:  // SELECT value
+        fprintf(stdout, "%s\n", entries[i].value.c_str());
+        break;
+      case 3:  // SELECT *
+        fprintf(stdout, "%d '%s'\n", entries[i].key, entries[i].value.c_str());
+        break;
+      }
+    }
+  }
+  return 0;
+}
+
 RC SqlEngine::select(int attr, const string& table, const vector<SelCond>& cond)
 {
   RecordFile rf;   // RecordFile containing the table
@@ -41,24 +492,52 @@ RC SqlEngine::select(int attr, const string& table, const vector<SelCond>& cond)
   IndexCursor cursor;
 
   bool hasIndex;
+  bool keyOnly;    // true if the query needs no value of the tuples
 
   RC     rc;
   int    key;     
   string value;
   int    count;
+  int    smallest, largest; // the smallest and the largest matching key
   int    diff;
   int    lookup;
 
-  // open the table file
-  if ((rc = rf.open(table + ".tbl", 'r')) < 0) {
+  // the index entries whose tuples are being fetched
+  int      keys[RecordFile::PREFETCH_BATCH];
+  RecordId rids[RecordFile::PREFETCH_BATCH];
+  int      batchSize, batchPos, batchMax;
+
+  // open the table file.
+  // the table and the index are only read, so they are memory-mapped
+  if ((rc = rf.open(table + ".tbl", 'm')) < 0) {
     fprintf(stderr, "Error: table %s does not exist\n", table.c_str());
     return rc;
   }
 
   // Open the index file, if exists
-  if (!index.open(table+".idx", 'r'))
+  hasIndex = (index.open(table+".idx", 'm') == 0);
+
+  // COUNT(*), MIN(key) and MAX(key) of a whole table are answered from
+  // the record count and the zone map of the table, or from the first
+  // and the last leaf nodes of the index, without reading the tuples
+  if (cond.empty() && attr >= 4) {
+    if (attr == 4 && rf.countRecords(count))
+      goto finish_read;
+    if (attr >= 5 && rf.getKeyBounds(smallest, largest)) {
+      count = 1;
+      goto finish_read;
+    }
+    if (attr >= 5 && hasIndex && index.getKeyBounds(smallest, largest) == 0) {
+      count = 1;
+      goto finish_read;
+    }
+  }
+
+  if (hasIndex)
   {
     // Run this algorithm if index exists
+    // Tuples are fetched in key order, not in the order of the table file
+    rf.advise(PageFile::RANDOM);
 
     lookup = -1;
 
@@ -83,23 +562,80 @@ RC SqlEngine::select(int attr, const string& table, const vector<SelCond>& cond)
       }
     }
 
+    // A query on keys alone is covered by the index. Its tuples are
+    // answered from the leaf entries, without reading the table
+    keyOnly = (attr == 1 || attr >= 4);
+    for (unsigned i = 0; i < cond.size(); i++)
+    {
+      if (cond[i].attr != 1)
+        keyOnly = false;
+    }
+
     // Locate cursor in index tree
     if (lookup > -1)
       index.locate(atoi(cond[lookup].value), cursor);
     else
       index.locate(0,cursor); //Finds first entry in tree
 
-    // Scan the table beginning from the cursor
+    // A large range is read in rid order, i.e., page by page
+    if (!keyOnly)
+    {
+      int minKey, maxKey;
+      getKeyRange(cond, minKey, maxKey);
+      if (lookup == -1 || cond[lookup].comp != SelCond::EQ)
+      {
+        if (estimateTuples(rf, minKey, maxKey) >= RID_ORDER_MIN_TUPLES)
+        {
+          rc = fetchInRidOrder(rf, index, cursor, maxKey, attr, cond, count, smallest, largest);
+          if (rc < 0) {
+            fprintf(stderr, "Error: while reading a tuple from table %s\n", table.c_str());
+            goto exit_select;
+          }
+          goto finish_read;
+        }
+      }
+    }
+
+    // Scan the table beginning from the cursor.
+    // The index entries are read in batches, and the pages of the tuples
+    // of a batch are read in parallel before the tuples are examined.
+    // The batches start small, because an equality lookup stops early.
     count = 0;
-    while (!index.readForward(cursor, key, rid))
+    batchSize = batchPos = 0;
+    batchMax = 4;
+    for (;;)
     {
-      // read the tuple
-      if ((rc = rf.read(rid, key, value)) < 0) {
+      if (batchPos == batchSize)
+      {
+        for (batchSize = 0; batchSize < batchMax; batchSize++)
+        {
+          if (index.readForward(cursor, keys[batchSize], rids[batchSize]))
+            break;
+        }
+        if (batchSize == 0)
+          break;
+        if (!keyOnly)
+          rf.prefetch(rids, batchSize);
+        batchPos = 0;
+        if (batchMax < RecordFile::PREFETCH_BATCH)
+          batchMax *= 2;
+      }
+      key = keys[batchPos];
+      rid = rids[batchPos++];
+
+      // read the tuple. A query covered by the index only checks
+      // that the entry points to a tuple of the table
+      if (keyOnly)
+        rc = (rid.pid < 0 || rid.sid < 0 || rid >= rf.endRid()) ? RC_INVALID_RID : 0;
+      else
+        rc = rf.read(rid, key, value);
+      if (rc < 0) {
         fprintf(stderr, "Error: while reading a tuple from table %s\n", table.c_str());
         goto exit_select;
       }
 
-      // Check the conditions on the tuple
+      // Check the conditions on the tuple. A tuple that fails one
+      // is skipped, and a failed upper bound on the key ends the scan
       for (unsigned i = 0; i < cond.size(); i++)
       {
         // Compute the difference betweent the tuple and the condition
@@ -117,39 +653,44 @@ RC SqlEngine::select(int attr, const string& table, const vector<SelCond>& cond)
         switch (cond[i].comp)
         {
         case SelCond::EQ:
-          if (diff != 0)
+          if (diff != 0) {
             if (cond[i].attr == 1)
               goto finish_read;
             else
-              continue;
+              goto next_entry;
+          }
           break;
         case SelCond::NE:
-          if (diff == 0) continue;
+          if (diff == 0) goto next_entry;
           break;
         case SelCond::GT:
-          if (diff <= 0) continue;
+          if (diff <= 0) goto next_entry;
           break;
         case SelCond::LT:
-          if (diff >= 0)
+          if (diff >= 0) {
             if (cond[i].attr == 1)
               goto finish_read;
             else
-              continue;
+              goto next_entry;
+          }
           break;
         case SelCond::GE:
-          if (diff < 0) continue;
+          if (diff < 0) goto next_entry;
           break;
         case SelCond::LE:
-          if (diff > 0)
+          if (diff > 0) {
             if (cond[i].attr == 1)
               goto finish_read;
             else
-              continue;
+              goto next_entry;
+          }
           break;
         }
       }
 
       // Tuple matches conditions. Increment count
+      if (count == 0 || key < smallest) smallest = key;
+      if (count == 0 || key > largest) largest = key;
       count++;
 
       // print the tuple 
@@ -164,82 +705,69 @@ RC SqlEngine::select(int attr, const string& table, const vector<SelCond>& cond)
         fprintf(stdout, "%d '%s'\n", key, value.c_str());
         break;
       }
+
+      // Move to the next index entry
+      next_entry:
+      ;
     }
   }
   else
   {
-    // scan the table file from the beginning if no index
-    rid.pid = rid.sid = 0;
-    count = 0;
-    while (rid < rf.endRid()) {
-      // read the tuple
-      if ((rc = rf.read(rid, key, value)) < 0) {
-        fprintf(stderr, "Error: while reading a tuple from table %s\n", table.c_str());
-        goto exit_select;
-      }
+    // scan the table file from the beginning if no index.
+    // the records of a page are examined in place, without copying them
+    // the pages whose keys cannot meet the conditions are skipped,
+    // and so are the blocks that cannot have the value of an equality
+    int minKey, maxKey;
+    const char* eqValue = NULL;
+    getKeyRange(cond, minKey, maxKey);
+    for (unsigned i = 0; i < cond.size() && eqValue == NULL; i++) {
+      if (cond[i].attr == 2 && cond[i].comp == SelCond::EQ) eqValue = cond[i].value;
+    }
 
-      // check the conditions on the tuple
+    // in a DICTIONARY table, a value condition is compared once with each
+    // value of the dictionary, and a tuple looks up the result by its code
+    vector< vector<int> > codeDiff(cond.size());
+    if (rf.getFormat() == RecordFile::DICTIONARY) {
       for (unsigned i = 0; i < cond.size(); i++) {
-        // compute the difference between the tuple and the condition value
-        switch (cond[i].attr) {
-        case 1:
-	  diff = key - atoi(cond[i].value);
-	  break;
-        case 2:
-	  diff = strcmp(value.c_str(), cond[i].value);
-	  break;
-        }
-
-        // skip the tuple if any condition is not met
-        switch (cond[i].comp) {
-        case SelCond::EQ:
-	  if (diff != 0) goto next_tuple;
-	  break;
-        case SelCond::NE:
-	  if (diff == 0) goto next_tuple;
-	  break;
-        case SelCond::GT:
-	  if (diff <= 0) goto next_tuple;
-	  break;
-        case SelCond::LT:
-	  if (diff >= 0) goto next_tuple;
-	  break;
-        case SelCond::GE:
-	  if (diff < 0) goto next_tuple;
-	  break;
-        case SelCond::LE:
-	  if (diff > 0) goto next_tuple;
-	  break;
+        if (cond[i].attr != 2) continue;
+        codeDiff[i].resize(rf.getDictionarySize());
+        for (int c = 0; c < rf.getDictionarySize(); c++) {
+          const string& v = rf.getDictionaryValue(c);
+          codeDiff[i][c] = compareValue(v.data(), v.size(), cond[i].value);
         }
       }
+    }
 
-      // the condition is met for the tuple. 
-      // increase matching tuple counter
-      count++;
-
-      // print the tuple 
-      switch (attr) {
-      case 1:  // SELECT key
-        fprintf(stdout, "%d\n", key);
-        break;
-      case 2:  // SELECT value
-        fprintf(stdout, "%s\n", value.c_str());
-        break;
-      case 3:  // SELECT *
-        fprintf(stdout, "%d '%s'\n", key, value.c_str());
-        break;
-      }
-
-      // move to the next tuple
-      next_tuple:
-      ++rid;
+    // the table is scanned in morsels by the scan threads
+    ScanJob job;
+    job.rf = &rf;
+    job.cond = &cond;
+    job.codeDiff = &codeDiff;
+    job.attr = attr;
+    job.minKey = minKey;
+    job.maxKey = maxKey;
+    job.eqValue = eqValue;
+    if ((rc = runScan(job, scanThreads, orderedScan)) < 0) {
+      fprintf(stderr, "Error: while reading a tuple from table %s\n", table.c_str());
+      goto exit_select;
     }
+    count = job.count;
+    smallest = job.smallest;
+    largest = job.largest;
   }
   finish_read:
-  // print matching tuple count if "select count(*)"
+  // print matching tuple count if "select count(*)", and the smallest or
+  // the largest key of the matching tuples if "select min(key)" or
+  // "select max(key)". an empty result has no smallest or largest key
   if (attr == 4) {
     fprintf(stdout, "%d\n", count);
   }
+  else if (attr == 5 && count > 0) {
+    fprintf(stdout, "%d\n", smallest);
+  }
+  else if (attr == 6 && count > 0) {
+    fprintf(stdout, "%d\n", largest);
+  }
   rc = 0;
 
   // close the table file and return
@@ -248,11 +776,19 @@ RC SqlEngine::select(int attr, const string& table, const vector<SelCond>& cond)
   return rc;
 }
 
-RC SqlEngine::load(const string& table, const string& loadfile, bool index)
+RC SqlEngine::load(const string& table, const string& loadfile, const LoadOpt& opt)
 {
-  //Open the table RecordFile
+  bool index = opt.index;
+
+  if (opt.pageSize != 0 && !PageFile::isValidPageSize(opt.pageSize)) {
+    cout << "Error: Invalid page size " << opt.pageSize << endl;
+    return RC_INVALID_ATTRIBUTE;
+  }
+
+  //Open the table RecordFile.
+  //The page size, compression and format only apply when the table is created
   RecordFile rf;
-  if (rf.open(table+".tbl",'w')) {
+  if (rf.open(table+".tbl",'w',opt.pageSize,opt.compress,opt.format)) {
     cout << "Error: Could Not Access File" << endl;
     return 1;
   }
@@ -269,7 +805,7 @@ RC SqlEngine::load(const string& table, const string& loadfile, bool index)
   BTreeIndex btindex;
   if (index)
   {
-    if(btindex.open(table+".idx",'w'))
+    if(btindex.open(table+".idx",'w',opt.pageSize))
     {
       cout << "Error: Could Not Access Index" << endl;
       return 1;
@@ -277,33 +813,52 @@ RC SqlEngine::load(const string& table, const string& loadfile, bool index)
   }
 
   string line;
-  //Parse each line and append to RecordFile
-  while(lf.good()) {
-    int key;
-    string value;
-    RecordId temp;
-    getline(lf,line);
-    if (parseLoadLine(line, key, value)) {
-      continue;
-    }
-    if (rf.append(key, value, temp)) {
-      cout << "Warning: Could not add line to RecordFile" << endl;
-      continue;
-    }
-    if (index)
-    {
-      if(btindex.insert(key, temp))
-      {
-        cout << "Warning: Could not insert key into index" << endl;
+  {
+    //Parse each line and append to RecordFile.
+    //The appender writes each page of the table once, when it is full.
+    //It goes out of scope before the table is closed
+    RecordFile::BulkAppender appender(rf);
+    while(lf.good()) {
+      int key;
+      string value;
+      RecordId temp;
+      getline(lf,line);
+      if (parseLoadLine(line, key, value)) {
+        continue;
+      }
+      if (appender.append(key, value, temp)) {
+        cout << "Warning: Could not add line to RecordFile" << endl;
         continue;
       }
+      if (index)
+      {
+        if(btindex.insert(key, temp))
+        {
+          cout << "Warning: Could not insert key into index" << endl;
+          continue;
+        }
+      }
+    }
+    if (appender.flush()) {
+      cout << "Warning: Could not write the last page of the RecordFile" << endl;
     }
   }
-  rf.close();
+  // with the pages cached in the buffer pool, a write error may only
+  // show up when the table and the index are written out on close
+  RC rc = rf.close();
+  if (rc < 0) {
+    cout << "Error: Could not write the RecordFile" << endl;
+  }
   lf.close();
   if (index)
-    btindex.close();
-  return 0;
+  {
+    RC irc;
+    if ((irc = btindex.close()) < 0) {
+      cout << "Error: Could not write the index" << endl;
+      if (rc == 0) rc = irc;
+    }
+  }
+  return rc;
 }
 
 RC SqlEngine::parseLoadLine(const string& line, int& key, string& value)
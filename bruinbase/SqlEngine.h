@@ -23,6 +23,18 @@ struct SelCond {
   char* value;  // the value to compare
 };
 
+/**
+ * data structure to represent the options of a LOAD command
+ */
+struct LoadOpt {
+  bool index;     // true if "WITH INDEX" was specified
+  int  pageSize;  // "PAGESIZE n": the page size of a new table and index.
+                  //   0 for the default
+  bool compress;  // true if "COMPRESS" was specified for a new table
+  RecordFile::Format format; // "FORMAT 'fixed'|'slotted'|'pax'|'dictionary'":
+                  //   the record format of a new table. FIXED by default
+};
+
 /**
  * the class that takes, parses, and executes the user commands.
  */
@@ -43,7 +55,7 @@ class SqlEngine {
    * all conditions in conds must be ANDed together.
    * the result of the SELECT is printed on screen.
    * @param attr[IN] attribute in the SELECT clause
-   * (1: key, 2: value, 3: *, 4: count(*))
+   * (1: key, 2: value, 3: *, 4: count(*), 5: min(key), 6: max(key))
    * @param table[IN] the table name in the FROM clause
    * @param conds[IN] list of conditions in the WHERE clause
    * @return error code. 0 if no error
@@ -54,10 +66,10 @@ class SqlEngine {
    * load a table from a load file.
    * @param table[IN] the table name in the LOAD command
    * @param loadfile[IN] the file name of the load file
-   * @param index[IN] true if "WITH INDEX" option was specified
+   * @param opt[IN] the options of the LOAD command
    * @return error code. 0 if no error
    */
-  static RC load(const std::string& table, const std::string& loadfile, bool index);
+  static RC load(const std::string& table, const std::string& loadfile, const LoadOpt& opt);
 
   /**
    * parse a line from the load file into the (key, value) pair.
@@ -67,6 +79,29 @@ class SqlEngine {
    * @return error code. 0 if no error
    */
   static RC parseLoadLine(const std::string& line, int& key, std::string& value);
+
+  // the most threads of a table scan
+  static const int MAX_SCAN_THREADS = 64;
+
+  /**
+   * set # threads that scan a table without an index. the table is
+   * divided into morsels of consecutive pages, which the threads take
+   * in turn. 1 scans the table in the thread of the SELECT.
+   * @param threads[IN] # scan threads, from 1 to MAX_SCAN_THREADS
+   */
+  static void setScanThreads(int threads);
+
+  /**
+   * set the order of the tuples printed by a table scan with several
+   * threads: the order of the table, or the order the morsels are
+   * scanned in, which does not wait for a slow morsel.
+   * @param ordered[IN] true for the order of the table
+   */
+  static void setOrderedScan(bool ordered);
+
+ private:
+  static int  scanThreads;  // # threads of a table scan
+  static bool orderedScan;  // true if a table scan prints in table order
 };
 
 #endif /* SQLENGINE_H */
@@ -1,12 +1,16 @@
 %{
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <sys/times.h>
+#include <unistd.h>
 #include <climits>
 #include <string>
 #include "Bruinbase.h"
 #include "SqlEngine.h" 
 #include "PageFile.h"
+#include "IOStats.h"
+#include "BufferPool.h"
 
 int  sqllex(void);  
 void sqlerror(const char *str) { fprintf(stderr, "Error: %s\n", str); }
@@ -16,15 +20,40 @@ static void runSelect(int attr, const char* table, const std::vector<SelCond>& c
 {
   struct tms tmsbuf;
   clock_t btime, etime;
-  int     bpagecnt, epagecnt;
 
   btime = times(&tmsbuf);
-  bpagecnt = PageFile::getPageReadCount();
+  IOStats::beginQuery();
   SqlEngine::select(attr, table, conds);
+  IOStats::endQuery();
   etime = times(&tmsbuf);
-  epagecnt = PageFile::getPageReadCount();
 
-  fprintf(stderr, "  -- %.3f seconds to run the select command. Read %d pages\n", ((float)(etime - btime))/sysconf(_SC_CLK_TCK), epagecnt - bpagecnt);
+  const IOCounters& q = IOStats::lastQuery();
+  fprintf(stderr, "  -- %.3f seconds to run the select command. Read %lld pages (%lld prefetched), %lld cache hits, %lld system calls", ((float)(etime - btime))/sysconf(_SC_CLK_TCK), q.pagesRead, q.prefetched, q.hits, q.readCalls + q.writeCalls);
+  if (q.mapped > 0) fprintf(stderr, ", %lld mapped page reads", q.mapped);
+  if (q.skipped > 0) fprintf(stderr, ", %lld pages skipped", q.skipped);
+  if (q.blocksSkipped > 0) fprintf(stderr, " (%lld blocks by value filters)", q.blocksSkipped);
+  fprintf(stderr, "\n");
+}
+
+static void runCommand(const char* verb, const char* object, const char* format)
+{
+  if (strcasecmp(verb, "show") == 0 && strcasecmp(object, "stats") == 0) {
+    if (format == NULL) IOStats::print(stdout);
+    else if (strcasecmp(format, "json") == 0) IOStats::dump(stdout);
+    else sqlerror("unknown SHOW STATS format");
+  } else if (strcasecmp(verb, "save") == 0 && strcasecmp(object, "cache") == 0 &&
+             format == NULL) {
+    RC rc = BufferPool::saveWarmup();
+    if (rc < 0) sqlerror("could not save the warm-up file");
+    else fprintf(stdout, "%d cached pages saved\n", rc);
+  } else if (strcasecmp(verb, "set") == 0 && strcasecmp(object, "scan") == 0 &&
+             format != NULL) {
+    if (strcasecmp(format, "ordered") == 0) SqlEngine::setOrderedScan(true);
+    else if (strcasecmp(format, "unordered") == 0) SqlEngine::setOrderedScan(false);
+    else sqlerror("unknown SET SCAN order. neither ordered or unordered");
+  } else {
+    sqlerror("syntax error");
+  }
 }
 
 %}
@@ -34,6 +63,7 @@ static void runSelect(int attr, const char* table, const std::vector<SelCond>& c
   char* string;
   SelCond* cond;
   std::vector<SelCond>* conds;
+  LoadOpt* loadopt;
 }
 
 %token SELECT FROM WHERE LOAD WITH INDEX QUIT COUNT AND OR 
@@ -45,6 +75,19 @@ static void runSelect(int attr, const char* table, const std::vector<SelCond>& c
 %type <string> table value
 %type <cond> condition
 %type <conds> conditions
+%type <loadopt> load_options
+
+/* free the values of the symbols discarded by error recovery, e.g., the
+   table and file names of a LOAD whose options are rejected by YYERROR.
+   the symbols of the rule whose action calls YYERROR are not discarded,
+   so the action frees them itself */
+%destructor { free($$); } <string>
+%destructor { free($$->value); delete $$; } <cond>
+%destructor {
+  for (unsigned i = 0; i < $$->size(); i++) free((*$$)[i].value);
+  delete $$;
+} <conds>
+%destructor { delete $$; } <loadopt>
 %%
 
 commands:
@@ -55,6 +98,7 @@ commands:
 command:
         load_command { fprintf(stdout, "Bruinbase> "); }
 	| select_command { fprintf(stdout, "Bruinbase> "); }
+	| admin_command { fprintf(stdout, "Bruinbase> "); }
 	| quit_command
 	| error LF { fprintf(stdout, "Bruinbase> "); }
 	| LF { fprintf(stdout, "Bruinbase> "); }
@@ -65,15 +109,81 @@ quit_command:
 	;
 
 load_command:
-	LOAD table FROM STRING LF { 
-	  SqlEngine::load(std::string($2), std::string($4), false); 
+	LOAD table FROM STRING load_options LF { 
+	  IOStats::beginQuery();
+	  SqlEngine::load(std::string($2), std::string($4), *$5); 
+	  IOStats::endQuery();
 	  free($2);
 	  free($4);
+	  delete $5;
+	}
+	;
+
+load_options:
+	/* no option */ {
+	  LoadOpt* o = new LoadOpt;
+	  o->index = false;
+	  o->pageSize = 0;
+	  o->compress = false;
+	  o->format = RecordFile::FIXED;
+	  $$ = o;
 	}
-	| LOAD table FROM STRING WITH INDEX LF { 
-	  SqlEngine::load(std::string($2), std::string($4), true); 
+	| load_options WITH INDEX {
+	  $1->index = true;
+	  $$ = $1;
+	}
+	| load_options ID {
+	  bool known = (strcasecmp($2, "compress") == 0);
+	  if (known) $1->compress = true;
 	  free($2);
-	  free($4);
+	  if (!known) {
+	    sqlerror("unknown LOAD option");
+	    delete $1;
+	    YYERROR;
+	  }
+	  $$ = $1;
+	}
+	| load_options ID STRING {
+	  bool known = (strcasecmp($2, "format") == 0);
+	  if (known && strcasecmp($3, "slotted") == 0) $1->format = RecordFile::SLOTTED;
+	  else if (known && strcasecmp($3, "pax") == 0) $1->format = RecordFile::PAX;
+	  else if (known && strcasecmp($3, "dictionary") == 0) $1->format = RecordFile::DICTIONARY;
+	  else if (known && strcasecmp($3, "fixed") == 0) $1->format = RecordFile::FIXED;
+	  else known = false;
+	  free($2);
+	  free($3);
+	  if (!known) {
+	    sqlerror("unknown LOAD option");
+	    delete $1;
+	    YYERROR;
+	  }
+	  $$ = $1;
+	}
+	| load_options ID INTEGER {
+	  bool known = (strcasecmp($2, "pagesize") == 0);
+	  if (known) $1->pageSize = atoi($3);
+	  free($2);
+	  free($3);
+	  if (!known) {
+	    sqlerror("unknown LOAD option");
+	    delete $1;
+	    YYERROR;
+	  }
+	  $$ = $1;
+	}
+	;
+
+admin_command:
+	ID ID LF {
+	  runCommand($1, $2, NULL);
+	  free($1);
+	  free($2);
+	}
+	| ID ID ID LF {
+	  runCommand($1, $2, $3);
+	  free($1);
+	  free($2);
+	  free($3);
 	}
 	;
 
@@ -121,6 +231,17 @@ attributes:
 	attribute { $$ = $1; }
 	| STAR  { $$ = 3; }
 	| COUNT { $$ = 4; }
+	| ID '(' attribute ')' {
+		bool known = ($3 == 1);
+		if (known && strcasecmp($1, "min") == 0) $$ = 5;
+		else if (known && strcasecmp($1, "max") == 0) $$ = 6;
+		else known = false;
+		free($1);
+		if (!known) {
+		  sqlerror("unknown aggregate. only min(key) and max(key) are supported");
+		  YYERROR;
+		}
+	}
 	;
 
 attribute:
@@ -363,8 +363,8 @@ static void yy_fatal_error (yyconst char msg[]  );
 	*yy_cp = '\0'; \
 	(yy_c_buf_p) = yy_cp;
 
-#define YY_NUM_RULES 26
-#define YY_END_OF_BUFFER 27
+#define YY_NUM_RULES 27
+#define YY_END_OF_BUFFER 28
 /* This struct is not used in this scanner,
    but its presence is necessary. */
 struct yy_trans_info
@@ -372,12 +372,12 @@ struct yy_trans_info
 	flex_int32_t yy_verify;
 	flex_int32_t yy_nxt;
 	};
-static yyconst flex_int16_t yy_accept[113] =
+static yyconst flex_int16_t yy_accept[114] =
     {   0,
-        0,    0,   27,   26,   25,   23,   26,   26,   22,   21,
-       26,   18,   24,   15,   12,   14,   20,   20,   20,   20,
+        0,    0,   28,   27,   26,   24,   27,   27,   22,   21,
+       27,   18,   25,   15,   12,   14,   20,   20,   20,   20,
        20,   20,   20,   20,   20,   20,   20,   20,   20,   20,
-       20,   20,   20,   20,   20,   20,   20,   25,   23,    0,
+       20,   20,   20,   20,   20,   20,   20,   26,   24,    0,
        19,   18,   17,   13,   16,   20,   20,   20,   20,   20,
        20,   20,   11,   20,   20,   20,   20,   20,   20,   20,
        20,   20,   20,   20,   20,   20,   20,   10,   20,   20,
@@ -386,7 +386,7 @@ static yyconst flex_int16_t yy_accept[113] =
         4,    7,   20,   20,    5,   20,   20,   20,   20,   20,
 
         6,   20,    3,   20,   20,    0,    1,    0,    0,    0,
-        9,    0
+        9,   23,    0
     } ;
 
 static yyconst flex_int32_t yy_ec[256] =
@@ -431,7 +431,7 @@ static yyconst flex_int32_t yy_meta[54] =
         2,    2,    2
     } ;
 
-static yyconst flex_int16_t yy_base[115] =
+static yyconst flex_int16_t yy_base[116] =
     {   0,
         0,    0,  144,  145,  141,  145,  139,  136,  145,  145,
       129,  128,  145,   40,  145,  124,  111,    0,  109,  101,
@@ -445,29 +445,29 @@ static yyconst flex_int16_t yy_base[115] =
         0,    0,   58,   55,    0,   24,   20,   35,   32,   64,
 
         0,   38,    0,   62,   17,   58,    0,   57,   57,   56,
-      145,  145,   59,   60
+      145,  145,  145,   59,   60
     } ;
 
-static yyconst flex_int16_t yy_def[115] =
+static yyconst flex_int16_t yy_def[116] =
     {   0,
-      112,    1,  112,  112,  112,  112,  112,  113,  112,  112,
-      112,  112,  112,  112,  112,  112,  114,  114,  114,  114,
-      114,  114,  114,  114,  114,  114,  114,  114,  114,  114,
-      114,  114,  114,  114,  114,  114,  114,  112,  112,  113,
-      112,  112,  112,  112,  112,  114,  114,  114,  114,  114,
-      114,  114,  114,  114,  114,  114,  114,  114,  114,  114,
-      114,  114,  114,  114,  114,  114,  114,  114,  114,  114,
-      114,  114,  114,  114,  114,  114,  114,  114,  114,  114,
-      114,  114,  114,  114,  114,  114,  114,  114,  114,  114,
-      114,  114,  114,  114,  114,  114,  114,  114,  114,  114,
-
-      114,  114,  114,  114,  114,  112,  114,  112,  112,  112,
-      112,    0,  112,  112
+      113,    1,  113,  113,  113,  113,  113,  114,  113,  113,
+      113,  113,  113,  113,  113,  113,  115,  115,  115,  115,
+      115,  115,  115,  115,  115,  115,  115,  115,  115,  115,
+      115,  115,  115,  115,  115,  115,  115,  113,  113,  114,
+      113,  113,  113,  113,  113,  115,  115,  115,  115,  115,
+      115,  115,  115,  115,  115,  115,  115,  115,  115,  115,
+      115,  115,  115,  115,  115,  115,  115,  115,  115,  115,
+      115,  115,  115,  115,  115,  115,  115,  115,  115,  115,
+      115,  115,  115,  115,  115,  115,  115,  115,  115,  115,
+      115,  115,  115,  115,  115,  115,  115,  115,  115,  115,
+
+      115,  115,  115,  115,  115,  113,  115,  113,  113,  113,
+      113,  113,    0,  113,  113
     } ;
 
 static yyconst flex_int16_t yy_nxt[199] =
     {   0,
-        4,    5,    6,    7,    8,    4,    4,    9,   10,   11,
+        4,    5,    6,    7,    8,  112,  112,    9,   10,   11,
        12,   13,   14,   15,   16,   17,   18,   19,   18,   20,
        21,   18,   22,   23,   18,   18,   24,   25,   18,   26,
        18,   18,   27,   18,    4,   28,   29,   18,   30,   31,
@@ -482,12 +482,12 @@ static yyconst flex_int16_t yy_nxt[199] =
        73,   72,   71,   70,   69,   68,   42,   41,   38,   65,
        64,   53,   63,   62,   61,   60,   59,   58,   55,   54,
        53,   52,   51,   50,   49,   48,   47,   45,   42,   42,
-       41,   39,   38,  112,    3,  112,  112,  112,  112,  112,
-      112,  112,  112,  112,  112,  112,  112,  112,  112,  112,
-      112,  112,  112,  112,  112,  112,  112,  112,  112,  112,
-      112,  112,  112,  112,  112,  112,  112,  112,  112,  112,
-      112,  112,  112,  112,  112,  112,  112,  112,  112,  112,
-      112,  112,  112,  112,  112,  112,  112,  112
+       41,   39,   38,  113,    3,  113,  113,  113,  113,  113,
+      113,  113,  113,  113,  113,  113,  113,  113,  113,  113,
+      113,  113,  113,  113,  113,  113,  113,  113,  113,  113,
+      113,  113,  113,  113,  113,  113,  113,  113,  113,  113,
+      113,  113,  113,  113,  113,  113,  113,  113,  113,  113,
+      113,  113,  113,  113,  113,  113,  113,  113
 
     } ;
 
@@ -498,8 +498,8 @@ static yyconst flex_int16_t yy_chk[199] =
         1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
         1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
         1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,   14,   14,   27,   27,   37,   37,  113,
-      113,  114,  110,  109,  108,  106,  105,  104,  102,  100,
+        1,    1,    1,   14,   14,   27,   27,   37,   37,  114,
+      114,  115,  110,  109,  108,  106,  105,  104,  102,  100,
        99,   98,   97,   96,   94,   93,   90,   87,   86,   85,
        84,   83,   82,   81,   80,   79,   78,   77,   76,   75,
        74,   73,   72,   71,   70,   69,   67,   66,   65,   64,
@@ -508,12 +508,12 @@ static yyconst flex_int16_t yy_chk[199] =
        52,   51,   50,   49,   48,   47,   42,   40,   38,   36,
        35,   34,   33,   32,   31,   30,   29,   28,   26,   25,
        24,   23,   22,   21,   20,   19,   17,   16,   12,   11,
-        8,    7,    5,    3,  112,  112,  112,  112,  112,  112,
-      112,  112,  112,  112,  112,  112,  112,  112,  112,  112,
-      112,  112,  112,  112,  112,  112,  112,  112,  112,  112,
-      112,  112,  112,  112,  112,  112,  112,  112,  112,  112,
-      112,  112,  112,  112,  112,  112,  112,  112,  112,  112,
-      112,  112,  112,  112,  112,  112,  112,  112
+        8,    7,    5,    3,  113,  113,  113,  113,  113,  113,
+      113,  113,  113,  113,  113,  113,  113,  113,  113,  113,
+      113,  113,  113,  113,  113,  113,  113,  113,  113,  113,
+      113,  113,  113,  113,  113,  113,  113,  113,  113,  113,
+      113,  113,  113,  113,  113,  113,  113,  113,  113,  113,
+      113,  113,  113,  113,  113,  113,  113,  113
 
     } ;
 
@@ -755,7 +755,7 @@ yy_match:
 			while ( yy_chk[yy_base[yy_current_state] + yy_c] != yy_current_state )
 				{
 				yy_current_state = (int) yy_def[yy_current_state];
-				if ( yy_current_state >= 113 )
+				if ( yy_current_state >= 114 )
 					yy_c = yy_meta[(unsigned int) yy_c];
 				}
 			yy_current_state = yy_nxt[yy_base[yy_current_state] + (unsigned int) yy_c];
@@ -897,27 +897,32 @@ YY_RULE_SETUP
 return STAR;
 	YY_BREAK
 case 23:
-/* rule 23 can match eol */
 YY_RULE_SETUP
 #line 43 "SqlParser.l"
-return LF;
+return sqltext[0]; /* e.g., the parentheses of min(key) */
 	YY_BREAK
 case 24:
+/* rule 24 can match eol */
 YY_RULE_SETUP
 #line 44 "SqlParser.l"
-/* ignore semicolon */
+return LF;
 	YY_BREAK
 case 25:
 YY_RULE_SETUP
 #line 45 "SqlParser.l"
-/* ignore white space */
+/* ignore semicolon */
 	YY_BREAK
 case 26:
 YY_RULE_SETUP
-#line 47 "SqlParser.l"
+#line 46 "SqlParser.l"
+/* ignore white space */
+	YY_BREAK
+case 27:
+YY_RULE_SETUP
+#line 48 "SqlParser.l"
 ECHO;
 	YY_BREAK
-#line 921 "lex.sql.c"
+#line 926 "lex.sql.c"
 case YY_STATE_EOF(INITIAL):
 	yyterminate();
 
@@ -1201,7 +1206,7 @@ static int yy_get_next_buffer (void)
 		while ( yy_chk[yy_base[yy_current_state] + yy_c] != yy_current_state )
 			{
 			yy_current_state = (int) yy_def[yy_current_state];
-			if ( yy_current_state >= 113 )
+			if ( yy_current_state >= 114 )
 				yy_c = yy_meta[(unsigned int) yy_c];
 			}
 		yy_current_state = yy_nxt[yy_base[yy_current_state] + (unsigned int) yy_c];
@@ -1229,11 +1234,11 @@ static int yy_get_next_buffer (void)
 	while ( yy_chk[yy_base[yy_current_state] + yy_c] != yy_current_state )
 		{
 		yy_current_state = (int) yy_def[yy_current_state];
-		if ( yy_current_state >= 113 )
+		if ( yy_current_state >= 114 )
 			yy_c = yy_meta[(unsigned int) yy_c];
 		}
 	yy_current_state = yy_nxt[yy_base[yy_current_state] + (unsigned int) yy_c];
-	yy_is_jam = (yy_current_state == 112);
+	yy_is_jam = (yy_current_state == 113);
 
 	return yy_is_jam ? 0 : yy_current_state;
 }
@@ -1903,7 +1908,7 @@ void sqlfree (void * ptr )
 
 #define YYTABLES_NAME "yytables"
 
-#line 47 "SqlParser.l"
+#line 48 "SqlParser.l"
 
 
 
@@ -7,13 +7,81 @@
  * @date 3/24/2008
  */
  
+#include <cstdio>
+#include <cstdlib>
+#include <strings.h>
+#include <unistd.h>
 #include "Bruinbase.h"
 #include "SqlEngine.h"
+#include "BufferPool.h"
+#include "PageFile.h"
 
-int main()
+static void usage(const char* name)
 {
+  fprintf(stderr, "usage: %s [-c cache size in MB] [-p lru|2q] [-f flush interval in msec] [-d] [-w warm-up file] [-t scan threads]\n", name);
+}
+
+int main(int argc, char* argv[])
+{
+  int  c;
+  long cacheSize = BufferPool::DEFAULT_POOL_SIZE;
+  BufferPool::Policy policy = BufferPool::LRU;
+  int  flushInterval = 1000;
+  const char* warmupFile = NULL;
+  int  scanThreads = 1;
+
+  // "-c size" sets the size of the buffer pool in MB
+  // "-p policy" sets the page replacement policy of the buffer pool
+  // "-f msec" sets the interval of the background flusher. 0 disables it
+  // "-d" reads and writes the files with direct I/O, bypassing the OS cache
+  // "-w file" loads the pages listed in the file into the buffer pool at
+  //   startup, and saves the list of cached pages to it at shutdown
+  // "-t threads" sets # threads of a table scan. 1 by default
+  while ((c = getopt(argc, argv, "c:p:f:dw:t:")) != -1) {
+    switch (c) {
+    case 'c':
+      cacheSize = atol(optarg) * 1024 * 1024;
+      break;
+    case 'p':
+      if (strcasecmp(optarg, "lru") == 0) policy = BufferPool::LRU;
+      else if (strcasecmp(optarg, "2q") == 0) policy = BufferPool::TWO_Q;
+      else { usage(argv[0]); return 1; }
+      break;
+    case 'f':
+      flushInterval = atoi(optarg);
+      break;
+    case 'd':
+      PageFile::setDirectIO(true);
+      break;
+    case 'w':
+      warmupFile = optarg;
+      break;
+    case 't':
+      scanThreads = atoi(optarg);
+      if (scanThreads < 1) { usage(argv[0]); return 1; }
+      break;
+    default:
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  if (BufferPool::init(cacheSize, BufferPool::DEFAULT_PARTITION_COUNT, policy) < 0) {
+    fprintf(stderr, "Error: invalid buffer pool size %ld\n", cacheSize);
+    return 1;
+  }
+  if (flushInterval > 0) BufferPool::startFlushers(flushInterval);
+  SqlEngine::setScanThreads(scanThreads);
+
+  // the warm-up file does not exist on the first run
+  if (warmupFile != NULL) BufferPool::startWarmup(warmupFile);
+
   // run the SQL engine taking user commands from standard input (console).
   SqlEngine::run(stdin);
 
+  if (warmupFile != NULL && BufferPool::saveWarmup() < 0) {
+    fprintf(stderr, "Error: could not save the warm-up file %s\n", warmupFile);
+  }
+
   return 0;
 }
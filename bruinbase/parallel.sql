@@ -0,0 +1,14 @@
+SELECT * FROM xl WHERE value = 'Captured'
+SELECT * FROM xl WHERE key > 400 AND key < 420
+SELECT COUNT(*) FROM xl WHERE value > 'M' AND value <= 'Q'
+SELECT * FROM fixed WHERE value < '2'
+SELECT * FROM dict WHERE value < '2'
+SET SCAN UNORDERED
+SELECT COUNT(*) FROM xl WHERE value > 'M' AND value <= 'Q'
+SELECT min(key) FROM xl WHERE value = 'Captured'
+SELECT max(key) FROM xl WHERE value = 'Captured'
+SELECT * FROM xl WHERE key = 4240
+SELECT COUNT(*) FROM xl_dict WHERE value <> 'Hard Evidence'
+SELECT COUNT(*) FROM fixed WHERE value >= 'S'
+SET SCAN ORDERED
+SELECT * FROM xl WHERE key >= 2000000000
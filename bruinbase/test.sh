@@ -1,10 +1,19 @@
 #!/bin/sh
 
-rm -f xsmall.tbl xsmall.idx
-rm -f small.tbl small.idx
-rm -f medium.tbl medium.idx
-rm -f large.tbl large.idx
-rm -f xlarge.tbl xlarge.idx
+rm -f xsmall.tbl* xsmall.idx
+rm -f small.tbl* small.idx
+rm -f medium.tbl* medium.idx
+rm -f large.tbl* large.idx
+rm -f xlarge.tbl* xlarge.idx
+rm -f fixed.tbl* fixed_idx.tbl* fixed_idx.idx
+rm -f slotted.tbl* slotted_idx.tbl* slotted_idx.idx
+rm -f long_fixed.tbl* long_slotted.tbl*
+rm -f twice.tbl* twice_slotted.tbl*
+rm -f compressed.tbl*
+rm -f xl.tbl*
+rm -f pax.tbl* pax_idx.tbl* pax_idx.idx long_pax.tbl*
+rm -f dict.tbl* dict_idx.tbl* dict_idx.idx xl_dict.tbl*
 
 ./bruinbase < test.sql
 
+./bruinbase -t 4 < parallel.sql
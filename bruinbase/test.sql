@@ -20,3 +20,145 @@ SELECT COUNT(*) FROM xlarge
 SELECT * FROM xlarge WHERE key = 4240
 SELECT * FROM xlarge WHERE key > 400 AND key < 500 AND key > 100 AND key < 4000000
 
+
+LOAD fixed FROM 'movie.del'
+LOAD fixed_idx FROM 'movie.del' WITH INDEX
+LOAD slotted FROM 'movie.del' FORMAT 'slotted'
+LOAD slotted_idx FROM 'movie.del' WITH INDEX FORMAT 'slotted'
+SELECT * FROM fixed WHERE key = 489
+SELECT * FROM fixed WHERE value = 'Captured'
+SELECT COUNT(*) FROM fixed WHERE value >= 'S'
+SELECT COUNT(*) FROM fixed WHERE key > 400 AND key < 500
+SELECT * FROM fixed_idx WHERE key = 489
+SELECT * FROM fixed_idx WHERE value = 'Captured'
+SELECT COUNT(*) FROM fixed_idx WHERE value >= 'S'
+SELECT COUNT(*) FROM fixed_idx WHERE key > 400 AND key < 500
+SELECT * FROM slotted WHERE key = 489
+SELECT * FROM slotted WHERE value = 'Captured'
+SELECT COUNT(*) FROM slotted WHERE value >= 'S'
+SELECT COUNT(*) FROM slotted WHERE key > 400 AND key < 500
+SELECT * FROM slotted_idx WHERE key = 489
+SELECT * FROM slotted_idx WHERE value = 'Captured'
+SELECT COUNT(*) FROM slotted_idx WHERE value >= 'S'
+SELECT COUNT(*) FROM slotted_idx WHERE key > 400 AND key < 500
+
+LOAD long_fixed FROM 'long.del'
+LOAD long_slotted FROM 'long.del' FORMAT 'slotted'
+SELECT * FROM long_fixed
+SELECT * FROM long_slotted
+
+LOAD twice FROM 'xsmall.del'
+LOAD twice FROM 'small.del'
+LOAD twice_slotted FROM 'xsmall.del' FORMAT 'slotted'
+LOAD twice_slotted FROM 'small.del'
+SELECT COUNT(*) FROM twice
+SELECT COUNT(*) FROM twice WHERE key <> 0
+SELECT * FROM twice WHERE key < 300
+SELECT COUNT(*) FROM twice_slotted
+SELECT COUNT(*) FROM twice_slotted WHERE key <> 0
+SELECT * FROM twice_slotted WHERE key < 300
+
+LOAD compressed FROM 'movie.del' COMPRESS
+SELECT COUNT(*) FROM fixed WHERE key <> 0
+SELECT key FROM fixed WHERE value < '2'
+SELECT value FROM fixed WHERE value < '2'
+SELECT * FROM fixed WHERE value < '2'
+SELECT * FROM fixed WHERE value = 'No Such Movie'
+SELECT COUNT(*) FROM compressed WHERE key <> 0
+SELECT * FROM compressed WHERE value < '2'
+
+LOAD xl FROM 'xlarge.del'
+SELECT * FROM xl WHERE key = 4240
+SELECT * FROM xl WHERE key > 400 AND key < 420
+SELECT COUNT(*) FROM xl WHERE key >= 2000000000
+SELECT * FROM xl WHERE key > 2016123411
+SELECT * FROM xl WHERE key < 2
+SELECT * FROM xl WHERE value = 'Captured'
+SELECT * FROM xl WHERE value = 'Captured' AND key < 1000
+SELECT COUNT(*) FROM xl WHERE value = 'Hard Evidence'
+SELECT * FROM xl WHERE value = 'No Such Movie'
+SELECT * FROM slotted WHERE value = 'No Such Movie'
+
+LOAD pax FROM 'movie.del' FORMAT 'pax'
+LOAD pax_idx FROM 'movie.del' WITH INDEX FORMAT 'pax'
+LOAD long_pax FROM 'long.del' FORMAT 'pax'
+SELECT * FROM pax WHERE key = 489
+SELECT * FROM pax WHERE value = 'Captured'
+SELECT COUNT(*) FROM pax WHERE value >= 'S'
+SELECT COUNT(*) FROM pax WHERE key > 400 AND key < 500
+SELECT * FROM pax WHERE value < '2'
+SELECT * FROM pax_idx WHERE key = 489
+SELECT * FROM pax_idx WHERE value = 'Captured'
+SELECT COUNT(*) FROM pax_idx WHERE value >= 'S'
+SELECT COUNT(*) FROM pax_idx WHERE key > 400 AND key < 500
+SELECT * FROM long_pax
+
+LOAD dict FROM 'movie.del' FORMAT 'dictionary'
+LOAD dict_idx FROM 'movie.del' WITH INDEX FORMAT 'dictionary'
+LOAD xl_dict FROM 'xlarge.del' FORMAT 'dictionary'
+SELECT * FROM dict WHERE key = 489
+SELECT * FROM dict WHERE value = 'Captured'
+SELECT COUNT(*) FROM dict WHERE value >= 'S'
+SELECT COUNT(*) FROM dict WHERE key > 400 AND key < 500
+SELECT * FROM dict WHERE value < '2'
+SELECT * FROM dict_idx WHERE key = 489
+SELECT * FROM dict_idx WHERE value = 'Captured'
+SELECT COUNT(*) FROM dict_idx WHERE value >= 'S'
+SELECT COUNT(*) FROM dict_idx WHERE key > 400 AND key < 500
+SELECT * FROM xl_dict WHERE value = 'Captured'
+SELECT COUNT(*) FROM xl_dict WHERE value = 'Hard Evidence'
+SELECT COUNT(*) FROM xl_dict WHERE value <> 'Hard Evidence'
+SELECT COUNT(*) FROM xl WHERE value <> 'Hard Evidence'
+SELECT COUNT(*) FROM xl_dict WHERE value > 'M' AND value <= 'Q'
+SELECT COUNT(*) FROM xl WHERE value > 'M' AND value <= 'Q'
+SELECT * FROM xl_dict WHERE value = 'No Such Movie'
+
+SELECT COUNT(*) FROM fixed
+SELECT min(key) FROM fixed
+SELECT max(key) FROM fixed
+SELECT min(key) FROM fixed WHERE key <> 0
+SELECT max(key) FROM fixed WHERE key <> 0
+SELECT COUNT(*) FROM fixed_idx
+SELECT min(key) FROM fixed_idx
+SELECT max(key) FROM fixed_idx
+SELECT COUNT(*) FROM pax
+SELECT min(key) FROM dict
+SELECT max(key) FROM dict
+SELECT COUNT(*) FROM xl
+SELECT min(key) FROM xl
+SELECT max(key) FROM xl
+SELECT min(key) FROM xl WHERE value = 'Captured'
+SELECT max(key) FROM xl WHERE value = 'Captured'
+SELECT min(key) FROM xl WHERE value = 'No Such Movie'
+SELECT COUNT(*) FROM xl WHERE value = 'No Such Movie'
+
+SELECT key FROM fixed_idx WHERE key > 4700
+SELECT COUNT(*) FROM fixed_idx WHERE key > 400 AND key < 500
+SELECT min(key) FROM fixed_idx WHERE key > 400 AND key < 500
+SELECT max(key) FROM fixed_idx WHERE key > 400 AND key < 500
+SELECT key FROM xlarge WHERE key >= 2010000000
+SELECT COUNT(*) FROM xlarge WHERE key > 2
+SELECT COUNT(*) FROM xl WHERE key > 2
+SELECT key FROM pax_idx WHERE key >= 4730
+SELECT * FROM pax_idx WHERE key >= 4730
+
+SELECT * FROM fixed_idx WHERE key > 400 AND key < 420
+SELECT * FROM fixed_idx WHERE key > 400 AND key < 420 AND value > 'Bi'
+SELECT * FROM fixed WHERE key > 400 AND key < 420 AND value > 'Bi'
+SELECT * FROM fixed_idx WHERE key > 400 AND key < 1000 AND value >= 'Cap' AND value < 'Car'
+SELECT * FROM fixed WHERE key > 400 AND key < 1000 AND value >= 'Cap' AND value < 'Car'
+SELECT COUNT(*) FROM fixed_idx WHERE key > 400 AND value > 'M'
+SELECT COUNT(*) FROM fixed WHERE key > 400 AND value > 'M'
+SELECT min(key) FROM fixed_idx WHERE key > 400 AND value > 'M'
+SELECT * FROM xlarge WHERE key > 652 AND key < 700 AND value = 'Captured'
+SELECT * FROM xlarge WHERE key > 652 AND value = 'Captured'
+SELECT * FROM xlarge WHERE key > 2 AND value = 'Captured'
+SELECT COUNT(*) FROM xlarge WHERE key > 2 AND value > 'M'
+SELECT COUNT(*) FROM xl WHERE key > 2 AND value > 'M'
+SELECT max(key) FROM xlarge WHERE key > 2 AND value > 'M'
+SELECT max(key) FROM xl WHERE key > 2 AND value > 'M'
+
+SELECT COUNT(*) FROM large WHERE key > 1388
+SELECT COUNT(*) FROM large WHERE key >= 1389
+SELECT * FROM large WHERE key > 1388 AND key < 1400
+SELECT COUNT(*) FROM large WHERE key > 1388 AND value > 'M'